@@ -0,0 +1,668 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arrange.h"
+
+/*
+ * Row profiles of the dynamic program, one entry per column: 0 for water, 1 for a ship
+ * that ends in the row and 1 + n for a vertical ship that needs n more cells below.
+ * Entries are packed into 64 bit words with @c width bits each.
+ */
+typedef struct arrange_codec {
+  int len;
+  int width;
+  /* entries per word */
+  int per;
+  int words;
+} ArrangeCodec;
+
+/*
+ * Fleets that can be left: ships left per distinct length, numbered in a mixed radix.
+ */
+typedef struct arrange_fleet {
+  int lengths;
+  /* distinct lengths, longest first, and the ships of each */
+  int *length;
+  int *total;
+  /* place value of each length in a fleet number */
+  long *weight;
+  long fleets;
+  /* fleets with at least the ships of fleet number u, starting at first[u] in fits */
+  long *first;
+  long *fits;
+} ArrangeFleet;
+
+/*
+ * States of one row: every profile reached, each with the arrangements leading to it
+ * for every fleet number. A profile and its mirror image have the same arrangements
+ * below, so they share the entry of the smaller one, which counts the arrangements
+ * of both.
+ */
+typedef struct arrange_table {
+  /* packed profiles and their fleet vectors in order of arrival */
+  uint64_t *keys;
+  uint64_t *ways;
+  size_t used;
+  size_t cap;
+  /* hash slots, 1 + profile number or 0 when free */
+  uint32_t *slots;
+  size_t mask;
+  int words;
+  long fleets;
+} ArrangeTable;
+
+/*
+ * Row fills of one profile. Each fill is applied to all fleets of the profile at once.
+ */
+typedef struct arrange_row {
+  int range;
+  int row;
+  const ArrangeFleet *fleet;
+  const ArrangeCodec *codec;
+  const uint32_t *prev;
+  const uint64_t *ways;
+  uint32_t *next;
+  /* ships used by the fill per length and as fleet number */
+  int *used;
+  long used_number;
+  uint64_t *packed;
+  ArrangeTable *out;
+  int error;
+} ArrangeRow;
+
+/*
+ * Ship by ship search over all placements.
+ */
+typedef struct arrange_search {
+  int range;
+  int ship_total;
+  /* ship lengths, longest first */
+  int *sizes;
+  /* ships touching each field */
+  int *block;
+} ArrangeSearch;
+
+/**
+ * @brief Seconds since a point in time.
+ *
+ * @param begin Start
+ * @return double
+ */
+static double arrange_since(struct timespec begin) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (double)(end.tv_sec - begin.tv_sec) + (double)(end.tv_nsec - begin.tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Sort helper for ship lengths, longest first.
+ */
+static int cmp_desc(const void *a, const void *b) {
+  int x = *(const int *)a, y = *(const int *)b;
+  return (x < y) - (x > y);
+}
+
+/**
+ * @brief Choose the packing of the profiles.
+ *
+ * @param codec Target Codec
+ * @param len Entries per Profile
+ * @param largest Largest Entry
+ */
+static void codec_init(ArrangeCodec *codec, int len, uint32_t largest) {
+  codec->len = len;
+  codec->width = 1;
+  while (codec->width < 32 && (largest >> codec->width) != 0) {
+    codec->width++;
+  }
+  codec->per = 64 / codec->width;
+  codec->words = (len + codec->per - 1) / codec->per;
+}
+
+/**
+ * @brief Pack a profile into words.
+ *
+ * @param codec Source Codec
+ * @param profile Profile Entries
+ * @param mirror Pack the entries right to left
+ * @param key Target Words
+ */
+static void codec_pack(const ArrangeCodec *codec, const uint32_t *profile, bool mirror, uint64_t *key) {
+  memset(key, 0, codec->words * sizeof(uint64_t));
+  for (int i = 0; i < codec->len; i++) {
+    uint32_t entry = profile[mirror ? codec->len - 1 - i : i];
+    key[i / codec->per] |= (uint64_t)entry << (codec->width * (i % codec->per));
+  }
+}
+
+/**
+ * @brief Unpack a profile from words.
+ *
+ * @param codec Source Codec
+ * @param key Source Words
+ * @param profile Target Profile Entries
+ */
+static void codec_unpack(const ArrangeCodec *codec, const uint64_t *key, uint32_t *profile) {
+  uint64_t mask = (1ULL << codec->width) - 1;
+  for (int i = 0; i < codec->len; i++) {
+    profile[i] = (uint32_t)((key[i / codec->per] >> (codec->width * (i % codec->per))) & mask);
+  }
+}
+
+/**
+ * @brief Check if a fleet holds at least the ships of another.
+ *
+ * @param fleet Source Fleets
+ * @param f Fleet Number
+ * @param u Fleet Number
+ * @return true
+ * @return false
+ */
+static bool fleet_covers(const ArrangeFleet *fleet, long f, long u) {
+  for (int k = 0; k < fleet->lengths; k++) {
+    long radix = fleet->total[k] + 1;
+    if (f / fleet->weight[k] % radix < u / fleet->weight[k] % radix)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Number the fleets that can be left of a configuration.
+ *
+ * @param fleet Target Fleets, release with @c fleet_free()
+ * @param config Board Size and Fleet
+ * @return int 0 on success, -1 when out of memory or above @c ARRANGE_MAX_STATES fleets
+ */
+static int fleet_init(ArrangeFleet *fleet, const Config *config) {
+  int *sizes = malloc(config->ship_total * sizeof(int));
+
+  memset(fleet, 0, sizeof(*fleet));
+  fleet->length = malloc(config->ship_total * sizeof(int));
+  fleet->total = calloc(config->ship_total, sizeof(int));
+  fleet->weight = malloc(config->ship_total * sizeof(long));
+  if (sizes == NULL || fleet->length == NULL || fleet->total == NULL || fleet->weight == NULL) {
+    free(sizes);
+    return -1;
+  }
+  memcpy(sizes, config->ship_mode, config->ship_total * sizeof(int));
+  qsort(sizes, config->ship_total, sizeof(int), cmp_desc);
+  for (int i = 0; i < config->ship_total; i++) {
+    if (fleet->lengths == 0 || fleet->length[fleet->lengths - 1] != sizes[i])
+      fleet->length[fleet->lengths++] = sizes[i];
+    fleet->total[fleet->lengths - 1]++;
+  }
+  free(sizes);
+
+  fleet->fleets = 1;
+  for (int k = 0; k < fleet->lengths; k++) {
+    fleet->weight[k] = fleet->fleets;
+    fleet->fleets *= fleet->total[k] + 1;
+    if (fleet->fleets > ARRANGE_MAX_STATES)
+      return -1;
+  }
+  long pairs = 0;
+  for (long u = 0; u < fleet->fleets; u++) {
+    for (long f = u; f < fleet->fleets; f++) {
+      pairs += fleet_covers(fleet, f, u);
+    }
+  }
+  fleet->first = malloc((fleet->fleets + 1) * sizeof(long));
+  fleet->fits = malloc(pairs * sizeof(long));
+  if (fleet->first == NULL || fleet->fits == NULL)
+    return -1;
+  pairs = 0;
+  for (long u = 0; u < fleet->fleets; u++) {
+    fleet->first[u] = pairs;
+    for (long f = u; f < fleet->fleets; f++) {
+      if (fleet_covers(fleet, f, u))
+        fleet->fits[pairs++] = f;
+    }
+  }
+  fleet->first[fleet->fleets] = pairs;
+  return 0;
+}
+
+/**
+ * @brief Release numbered fleets.
+ *
+ * @param fleet Target Fleets
+ */
+static void fleet_free(ArrangeFleet *fleet) {
+  free(fleet->length);
+  free(fleet->total);
+  free(fleet->weight);
+  free(fleet->first);
+  free(fleet->fits);
+}
+
+/**
+ * @brief Allocate an empty state table.
+ *
+ * @param table Target Table
+ * @param words Words per Profile
+ * @param fleets Fleets per Profile
+ * @return int 0 on success, -1 when out of memory
+ */
+static int table_init(ArrangeTable *table, int words, long fleets) {
+  memset(table, 0, sizeof(*table));
+  table->words = words;
+  table->fleets = fleets;
+  table->mask = 63;
+  table->slots = calloc(table->mask + 1, sizeof(uint32_t));
+  return table->slots != NULL ? 0 : -1;
+}
+
+/**
+ * @brief Release a state table.
+ *
+ * @param table Target Table
+ */
+static void table_free(ArrangeTable *table) {
+  free(table->keys);
+  free(table->ways);
+  free(table->slots);
+  memset(table, 0, sizeof(*table));
+}
+
+/**
+ * @brief FNV-1a hash of a packed profile.
+ *
+ * @param key Profile Words
+ * @param words Words per Profile
+ * @return uint32_t
+ */
+static uint32_t table_hash(const uint64_t *key, int words) {
+  // only used in memory, the byte order doesn't matter
+  return fnv1a(FNV_BASIS, key, words * sizeof(uint64_t));
+}
+
+/**
+ * @brief Hash slot of a profile.
+ *
+ * @param table Source Table
+ * @param key Profile Words
+ * @return size_t the slot holding the profile or the free slot for it
+ */
+static size_t table_slot(const ArrangeTable *table, const uint64_t *key) {
+  size_t i = table_hash(key, table->words) & table->mask;
+  size_t len = table->words * sizeof(uint64_t);
+
+  while (table->slots[i] != 0 && memcmp(table->keys + (table->slots[i] - 1) * table->words, key, len) != 0) {
+    i = (i + 1) & table->mask;
+  }
+  return i;
+}
+
+/**
+ * @brief Fleet vector of a profile, added when missing.
+ *
+ * Vectors move when the table grows.
+ *
+ * @param table Target Table
+ * @param key Profile Words
+ * @return uint64_t* arrangements per fleet number, NULL when out of memory or above
+ *                   @c ARRANGE_MAX_STATES states
+ */
+static uint64_t *table_find(ArrangeTable *table, const uint64_t *key) {
+  size_t i = table_slot(table, key);
+
+  if (table->slots[i] != 0)
+    return table->ways + (table->slots[i] - 1) * table->fleets;
+  if ((long)(table->used + 1) * table->fleets > ARRANGE_MAX_STATES || table->used + 1 >= UINT32_MAX)
+    return NULL;
+  if (table->used == table->cap) {
+    size_t cap = table->cap ? 2 * table->cap : 64;
+    uint64_t *keys = realloc(table->keys, cap * table->words * sizeof(uint64_t));
+    if (keys != NULL)
+      table->keys = keys;
+    uint64_t *ways = realloc(table->ways, cap * table->fleets * sizeof(uint64_t));
+    if (ways != NULL)
+      table->ways = ways;
+    if (keys == NULL || ways == NULL)
+      return NULL;
+    table->cap = cap;
+  }
+  if (2 * (table->used + 1) > table->mask + 1) {
+    uint32_t *slots = calloc(2 * (table->mask + 1), sizeof(uint32_t));
+    if (slots == NULL)
+      return NULL;
+    free(table->slots);
+    table->slots = slots;
+    table->mask = 2 * table->mask + 1;
+    for (size_t n = 0; n < table->used; n++) {
+      table->slots[table_slot(table, table->keys + n * table->words)] = (uint32_t)(n + 1);
+    }
+    i = table_slot(table, key);
+  }
+  memcpy(table->keys + table->used * table->words, key, table->words * sizeof(uint64_t));
+  memset(table->ways + table->used * table->fleets, 0, table->fleets * sizeof(uint64_t));
+  table->slots[i] = (uint32_t)(++table->used);
+  return table->ways + (table->used - 1) * table->fleets;
+}
+
+/**
+ * @brief Add a completed row fill to the next row.
+ *
+ * Every fleet with enough ships left for the fill passes its arrangements on to the
+ * fleet without them.
+ *
+ * @param t Source Transition
+ */
+static void arrange_fill(ArrangeRow *t) {
+  const ArrangeFleet *fleet = t->fleet;
+  const uint32_t *next = t->next;
+  int j = 0, range = t->range;
+  uint64_t *to;
+
+  while (j < range / 2 && next[j] == next[range - 1 - j]) {
+    j++;
+  }
+  codec_pack(t->codec, next, j < range / 2 && next[range - 1 - j] < next[j], t->packed);
+  if ((to = table_find(t->out, t->packed)) == NULL) {
+    t->error = -1;
+    return;
+  }
+  for (long i = fleet->first[t->used_number]; i < fleet->first[t->used_number + 1]; i++) {
+    long f = fleet->fits[i];
+    if (to[f - t->used_number] + t->ways[f] < t->ways[f])
+      t->error = -1;
+    to[f - t->used_number] += t->ways[f];
+  }
+}
+
+/**
+ * @brief Fill the cells of a row from column @c c on.
+ *
+ * @param t Source Transition
+ * @param c Column
+ * @param left Cell left of @c c holds a ship
+ */
+static void arrange_cells(ArrangeRow *t, int c, bool left) {
+  const uint32_t *prev = t->prev;
+  const ArrangeFleet *fleet = t->fleet;
+  uint32_t *next = t->next;
+  int range = t->range;
+
+  if (t->error != 0)
+    return;
+  if (c >= range) {
+    arrange_fill(t);
+    return;
+  }
+  if (prev[c] > 1) {
+    // vertical ship goes on
+    next[c] = prev[c] - 1;
+    arrange_cells(t, c + 1, true);
+    return;
+  }
+  next[c] = 0;
+  arrange_cells(t, c + 1, false);
+  if (left || prev[c] != 0 || (c > 0 && prev[c - 1] != 0) || (c + 1 < range && prev[c + 1] != 0))
+    return;
+
+  // a new ship starts at c
+  for (int k = 0; k < fleet->lengths; k++) {
+    int size = fleet->length[k];
+    if (t->used[k] == fleet->total[k])
+      continue;
+    t->used[k]++;
+    t->used_number += fleet->weight[k];
+    if (size == 1) {
+      next[c] = 1;
+      arrange_cells(t, c + 1, true);
+    } else {
+      if (t->row + size <= range) {
+        next[c] = (uint32_t)size;
+        arrange_cells(t, c + 1, true);
+      }
+      bool clear = c + size <= range;
+      for (int j = c + 2; clear && j <= c + size && j < range; j++) {
+        clear = prev[j] == 0;
+      }
+      if (clear) {
+        for (int j = c; j < c + size; j++) {
+          next[j] = 1;
+        }
+        if (c + size < range)
+          next[c + size] = 0;
+        arrange_cells(t, c + size + 1, false);
+      }
+    }
+    t->used[k]--;
+    t->used_number -= fleet->weight[k];
+  }
+}
+
+/**
+ * @brief Count the arrangements of a fleet with a row by row dynamic program.
+ *
+ * Walks the board row by row and keeps the number of arrangements leading to every
+ * row profile for every fleet that can be left. The fills of a row are enumerated once
+ * per profile and applied to all its fleets. Fails when a row has more than
+ * @c ARRANGE_MAX_STATES states.
+ *
+ * @param config Board Size and Fleet
+ * @param count Number of Arrangements
+ * @param stats Largest state count and time
+ * @return int 0 on success, -1 when the states don't fit or the count exceeds 64 bits
+ */
+int arrange_dp(const Config *config, uint64_t *count, ArrangeStats *stats) {
+  int range = config->game_range, ret = 0;
+  ArrangeTable cur = {0}, next = {0};
+  ArrangeFleet fleet;
+  ArrangeCodec codec;
+  struct timespec begin;
+
+  memset(stats, 0, sizeof(*stats));
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  *count = 0;
+  if (fleet_init(&fleet, config) != 0) {
+    fleet_free(&fleet);
+    return -1;
+  }
+  codec_init(&codec, range, (uint32_t)fleet.length[0]);
+  // profiles of the previous and the next row, ships used by a fill
+  uint32_t *profile = calloc(2 * range, sizeof(uint32_t));
+  int *used = calloc(fleet.lengths, sizeof(int));
+  uint64_t *packed = calloc(codec.words, sizeof(uint64_t));
+  uint64_t *ways;
+
+  if (profile == NULL || used == NULL || packed == NULL || table_init(&cur, codec.words, fleet.fleets) != 0 ||
+      (ways = table_find(&cur, packed)) == NULL) {
+    ret = -1;
+  } else {
+    // empty board with the whole fleet left
+    ways[fleet.fleets - 1] = 1;
+  }
+
+  for (int row = 0; row < range && ret == 0; row++) {
+    ArrangeRow t = {range, row, &fleet, &codec, profile, NULL, profile + range, used, 0, packed, &next, 0};
+    if (table_init(&next, codec.words, fleet.fleets) != 0) {
+      ret = -1;
+      break;
+    }
+    for (size_t n = 0; n < cur.used && t.error == 0; n++) {
+      codec_unpack(&codec, cur.keys + n * codec.words, profile);
+      t.ways = cur.ways + n * fleet.fleets;
+      arrange_cells(&t, 0, false);
+    }
+    ret = t.error;
+    table_free(&cur);
+    cur = next;
+    if ((long)(cur.used * fleet.fleets) > stats->states)
+      stats->states = (long)(cur.used * fleet.fleets);
+  }
+
+  // only complete fleets without a ship hanging off the board count
+  for (size_t n = 0; ret == 0 && n < cur.used; n++) {
+    bool done = true;
+    codec_unpack(&codec, cur.keys + n * codec.words, profile);
+    for (int j = 0; done && j < range; j++) {
+      done = profile[j] <= 1;
+    }
+    if (done && *count + cur.ways[n * fleet.fleets] < *count)
+      ret = -1;
+    else if (done)
+      *count += cur.ways[n * fleet.fleets];
+  }
+  table_free(&cur);
+  fleet_free(&fleet);
+  free(profile);
+  free(used);
+  free(packed);
+  stats->elapsed = arrange_since(begin);
+  return ret;
+}
+
+/**
+ * @brief Mark the fields a ship blocks.
+ *
+ * @param s Target Search
+ * @param row Row
+ * @param col Column
+ * @param rows Ship Height
+ * @param cols Ship Width
+ * @param delta 1 to place, -1 to remove
+ */
+static void arrange_mark(ArrangeSearch *s, int row, int col, int rows, int cols, int delta) {
+  int r0 = row > 0 ? row - 1 : 0, r1 = row + rows < s->range ? row + rows : s->range - 1;
+  int c0 = col > 0 ? col - 1 : 0, c1 = col + cols < s->range ? col + cols : s->range - 1;
+
+  for (int r = r0; r <= r1; r++) {
+    for (int c = c0; c <= c1; c++) {
+      s->block[r * s->range + c] += delta;
+    }
+  }
+}
+
+/**
+ * @brief Count the arrangements of the ships from @c index on.
+ *
+ * Placements are numbered (row * range + col) * 2 + direction. Ships of equal length
+ * are placed in increasing order, so every board is counted once.
+ *
+ * @param s Source Search
+ * @param index Ship
+ * @param from First Placement
+ * @param step Placement Stride, only used for the first ship
+ * @return uint64_t
+ */
+static uint64_t arrange_place(ArrangeSearch *s, int index, int from, int step) {
+  uint64_t total = 0;
+  int range = s->range, size;
+
+  if (index == s->ship_total)
+    return 1;
+  size = s->sizes[index];
+  for (int p = from; p < 2 * range * range; p += step) {
+    int row = p / 2 / range, col = p / 2 % range, dir = p % 2;
+    int rows = dir ? size : 1, cols = dir ? 1 : size;
+    bool free = row + rows <= range && col + cols <= range && !(dir && size == 1);
+    for (int i = 0; free && i < size; i++) {
+      free = s->block[(row + i * dir) * range + col + i * !dir] == 0;
+    }
+    if (!free)
+      continue;
+    arrange_mark(s, row, col, rows, cols, 1);
+    bool same = index + 1 < s->ship_total && s->sizes[index + 1] == size;
+    total += arrange_place(s, index + 1, same ? p + 1 : 0, 1);
+    arrange_mark(s, row, col, rows, cols, -1);
+  }
+  return total;
+}
+
+/**
+ * @brief Count the arrangements of a fleet by placing ship after ship.
+ *
+ * Works for every fleet the dynamic program has no room for, but visits every
+ * arrangement. The placements of the first ship are dealt round robin to
+ * @c workers processes.
+ *
+ * @param config Board Size and Fleet
+ * @param workers Worker Processes, 0 for one per processor
+ * @param count Number of Arrangements
+ * @param stats Workers and time
+ * @return int 0 on success, -1 on errors
+ */
+int arrange_dfs(const Config *config, int workers, uint64_t *count, ArrangeStats *stats) {
+  ArrangeSearch s = {config->game_range, config->ship_total, NULL, NULL};
+  struct timespec begin;
+  int ret = 0, started = 0;
+  int (*fds)[2];
+
+  memset(stats, 0, sizeof(*stats));
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  stats->dfs = true;
+  if (workers == 0)
+    workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  fds = calloc(workers > 0 ? workers : 1, sizeof(*fds));
+  *count = 0;
+  s.sizes = malloc(s.ship_total * sizeof(int));
+  s.block = calloc((size_t)s.range * s.range, sizeof(int));
+  if (workers < 1 || fds == NULL || s.sizes == NULL || s.block == NULL) {
+    free(fds);
+    free(s.sizes);
+    free(s.block);
+    return -1;
+  }
+  memcpy(s.sizes, config->ship_mode, s.ship_total * sizeof(int));
+  qsort(s.sizes, s.ship_total, sizeof(int), cmp_desc);
+
+  fflush(stdout);
+  for (; started < workers; started++) {
+    if (pipe(fds[started]) != 0)
+      break;
+    pid_t pid = fork();
+    if (pid < 0) {
+      close(fds[started][0]);
+      close(fds[started][1]);
+      break;
+    }
+    if (pid == 0) {
+      uint64_t part = arrange_place(&s, 0, started, workers);
+      _exit(write(fds[started][1], &part, sizeof(part)) == sizeof(part) ? 0 : 1);
+    }
+    close(fds[started][1]);
+  }
+  if (started < workers)
+    ret = -1;
+  for (int k = 0; k < started; k++) {
+    uint64_t part;
+    if (read(fds[k][0], &part, sizeof(part)) != sizeof(part))
+      ret = -1;
+    else
+      *count += part;
+    close(fds[k][0]);
+  }
+  while (started-- > 0) {
+    wait(NULL);
+  }
+  free(fds);
+  free(s.sizes);
+  free(s.block);
+  stats->workers = workers;
+  stats->elapsed = arrange_since(begin);
+  return ret;
+}
+
+/**
+ * @brief Count the arrangements of a fleet.
+ *
+ * Runs the dynamic program and falls back to the parallel search when its states
+ * don't fit.
+ *
+ * @param config Board Size and Fleet
+ * @param workers Worker Processes of the search, 0 for one per processor
+ * @param count Number of Arrangements
+ * @param stats Method, states, workers and time
+ * @return int 0 on success, -1 on errors
+ */
+int arrange_count(const Config *config, int workers, uint64_t *count, ArrangeStats *stats) {
+  if (arrange_dp(config, count, stats) == 0)
+    return 0;
+  return arrange_dfs(config, workers, count, stats);
+}
@@ -0,0 +1,31 @@
+#include "game.h"
+
+#ifndef BATTLESHIPS_ARRANGE_H
+#define BATTLESHIPS_ARRANGE_H
+
+#include <stdint.h>
+
+/* most states of a row the dynamic program keeps before giving up */
+#define ARRANGE_MAX_STATES (1L << 26)
+
+/*
+ * Counting of every legal fleet arrangement under the rules of isvalid(): ships don't
+ * overlap and don't touch, not even diagonally. Ships of equal length are
+ * interchangeable and single cell ships have one orientation, so every count is the
+ * number of distinct boards.
+ */
+typedef struct arrange_stats {
+  /* true if the search ran, false for the dynamic program */
+  bool dfs;
+  /* largest number of states in one row of the dynamic program */
+  long states;
+  int workers;
+  /* wall clock time in seconds */
+  double elapsed;
+} ArrangeStats;
+
+int arrange_dp(const Config *config, uint64_t *count, ArrangeStats *stats);
+int arrange_dfs(const Config *config, int workers, uint64_t *count, ArrangeStats *stats);
+int arrange_count(const Config *config, int workers, uint64_t *count, ArrangeStats *stats);
+
+#endif //BATTLESHIPS_ARRANGE_H
@@ -1,29 +1,211 @@
 #include "battleship.h"
 #include "helpers.h"
+#include "kernel.h"
+
+/**
+ * @brief Allocates a GameBoard.
+ *
+ * @param game_board Target Board
+ * @param game_range Target Board Dimension
+ * @param sparse Store only ship cells and shots instead of every field
+ * @return int 0 on success, -1 when out of memory
+ */
+int board_alloc(Board *game_board, int game_range, bool sparse) {
+  memset(game_board, 0, sizeof(*game_board));
+  game_board->game_range = game_range;
+  game_board->kernel = kernel_select(game_range, sparse);
+
+  if (sparse) {
+    if (sparse_init(&game_board->segments, 0) != 0 || sparse_init(&game_board->shots, 0) != 0) {
+      board_free(game_board);
+      return -1;
+    }
+    return 0;
+  }
+  // first dimension
+  game_board->cells = calloc(game_range, sizeof(Cell *));
+  if (game_board->cells == NULL)
+    return -1;
+  // second dimension, rows point into one block
+  Cell *cells = malloc((size_t)game_range * game_range * sizeof(Cell));
+  if (cells == NULL) {
+    board_free(game_board);
+    return -1;
+  }
+  for (int i = 0; i < game_range; i++) {
+    game_board->cells[i] = cells + (size_t)i * game_range;
+  }
+  board_clear(game_board, game_range);
+  // cleared in full once, later clears follow the log
+  game_board->touched = malloc((size_t)game_range * game_range * sizeof(uint32_t));
+  if (game_board->touched == NULL) {
+    board_free(game_board);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Releases a GameBoard from @c board_alloc().
+ *
+ * @param game_board Target Board
+ */
+void board_free(Board *game_board) {
+  if (game_board->cells != NULL) {
+    free(game_board->cells[0]);
+    free(game_board->cells);
+    game_board->cells = NULL;
+  }
+  free(game_board->touched);
+  game_board->touched = NULL;
+  if (game_board->segments.keys != NULL)
+    sparse_free(&game_board->segments);
+  if (game_board->shots.keys != NULL)
+    sparse_free(&game_board->shots);
+}
+
+/**
+ * @brief Reads a field of the GameBoard.
+ *
+ * Fired fields report HIT or MISS, the ship id stays visible.
+ *
+ * @param game_board Source Board
+ * @param row Row
+ * @param col Column
+ * @return Cell
+ */
+Cell board_cell(const Board *game_board, int row, int col) {
+  if (game_board->cells != NULL)
+    return game_board->cells[row][col];
+
+  Cell cell = {-1, WATER};
+  uint32_t key = (uint32_t)row * game_board->game_range + col;
+  int32_t value;
+  if (sparse_get(&game_board->segments, key, &value)) {
+    // ship id and symbol packed into one value
+    cell.shipid = value >> 8;
+    cell.symbol = value & 0xff;
+  }
+  if (sparse_get(&game_board->shots, key, &value))
+    cell.symbol = value;
+  return cell;
+}
+
+/**
+ * @brief Writes a field of the GameBoard.
+ *
+ * @param game_board Target Board
+ * @param row Row
+ * @param col Column
+ * @param cell New Field
+ * @return int 0 on success, -1 when out of memory
+ */
+int board_set(Board *game_board, int row, int col, Cell cell) {
+  if (game_board->cells != NULL) {
+    if (game_board->touched != NULL && game_board->cells[row][col].symbol == WATER && cell.symbol != WATER)
+      game_board->touched[game_board->touched_count++] = (uint32_t)row * game_board->game_range + col;
+    game_board->cells[row][col] = cell;
+    if (game_board->game_range <= KERNEL_RANGE) {
+      uint16_t *by_row = &game_board->occupancy[0][row + 1], *by_col = &game_board->occupancy[1][col + 1];
+      if (cell.symbol != WATER) {
+        *by_row |= (uint16_t)(1u << (col + 1));
+        *by_col |= (uint16_t)(1u << (row + 1));
+      } else {
+        *by_row &= (uint16_t)~(1u << (col + 1));
+        *by_col &= (uint16_t)~(1u << (row + 1));
+      }
+    }
+    return 0;
+  }
+
+  uint32_t key = (uint32_t)row * game_board->game_range + col;
+  if (cell.symbol == HIT || cell.symbol == MISS)
+    return sparse_put(&game_board->shots, key, cell.symbol);
+  if (cell.shipid > -1)
+    return sparse_put(&game_board->segments, key, (cell.shipid << 8) | cell.symbol);
+  return 0;
+}
 
 /**
  * @brief Clears all fields on the GameBoard.
  * 
  * Resets GameBoard by reseting important field values back to 0.
+ * Boards with a log of touched fields only reset those.
  * 
  * @param game_board Target Board
  * @param game_range Target Board Dimension
  */
-void board_clear(Cell **game_board, int game_range) {
+void board_clear(Board *game_board, int game_range) {
+  if (game_board->cells == NULL) {
+    sparse_reset(&game_board->segments);
+    sparse_reset(&game_board->shots);
+    return;
+  }
+  memset(game_board->occupancy, 0, sizeof(game_board->occupancy));
+  if (game_board->touched != NULL) {
+    Cell *cells = game_board->cells[0];
+    for (uint32_t k = 0; k < game_board->touched_count; k++) {
+      cells[game_board->touched[k]].symbol = WATER;
+      cells[game_board->touched[k]].shipid = -1;
+    }
+    game_board->touched_count = 0;
+    return;
+  }
   for (int i = 0; i < game_range; i++) {
     // game_board[i] = malloc(2 * game_range * sizeof(int)); memleak on reset
     for (int j = 0; j < game_range; j++) {
-      game_board[i][j].symbol = WATER;
-      game_board[i][j].shipid = -1;
+      game_board->cells[i][j].symbol = WATER;
+      game_board->cells[i][j].shipid = -1;
     }
   }
 }
 
+/**
+ * @brief Rebuilds the occupancy bits of a small dense board from its cells.
+ *
+ * Needed after the cells were written without @c board_set(), e.g. when they are
+ * mapped from a snapshot.
+ *
+ * @param game_board Target Board
+ */
+void board_occupancy(Board *game_board) {
+  memset(game_board->occupancy, 0, sizeof(game_board->occupancy));
+  if (game_board->cells == NULL || game_board->game_range > KERNEL_RANGE)
+    return;
+  for (int i = 0; i < game_board->game_range; i++) {
+    for (int j = 0; j < game_board->game_range; j++) {
+      if (game_board->cells[i][j].symbol != WATER) {
+        game_board->occupancy[0][i + 1] |= (uint16_t)(1u << (j + 1));
+        game_board->occupancy[1][j + 1] |= (uint16_t)(1u << (i + 1));
+      }
+    }
+  }
+}
+
+/**
+ * @brief Ship properties for a ship length.
+ *
+ * Ships shorter or longer than the built-in ones share the properties of the
+ * smallest or largest ship, so board symbols always stay in the known range.
+ *
+ * @param ship_type Ship Properties
+ * @param size Ship Length
+ * @return WaterCraft*
+ */
+WaterCraft *watercraft(WaterCraft *ship_type, int size) {
+  if (size < 2)
+    size = 2;
+  if (size > 5)
+    size = 5;
+  return &ship_type[size - 2];
+}
+
 /**
  * @brief Sets up ships on the GameBoard.
  * 
  * Places ships specified in the argument.
  * Placement on a per field bases depending on @c position, @c ship_mode and @c direction of ship.
+ * Also records the ship in the ship table of the board.
  * 
  * @param game_board Target Board
  * @param ship_type Ship Properties
@@ -31,15 +213,117 @@ void board_clear(Cell **game_board, int game_range) {
  * @param ship_mode Ship Length
  * @param direction Cardinal Direction
  * @param index Ship ID on the Target Board
+ * @return int 0 on success, -1 when out of memory
  */
-void board_fill(Cell **game_board, WaterCraft *ship_type, Coordinate position, int ship_mode, int direction, int index) {
+int board_fill(Board *game_board, WaterCraft *ship_type, Coordinate position, int ship_mode, int direction, int index) {
   for (int i = 0; i < ship_mode; i++) {
     int x = direction == 0 ? position.row : (position.row + i);
     int y = direction == 0 ? (position.col + i) : position.col;
 
-    game_board[x][y].symbol = ship_type[ship_mode - 2].id;
-    game_board[x][y].shipid = index;
+    Cell cell = {index, watercraft(ship_type, ship_mode)->id};
+    if (board_set(game_board, x, y, cell) != 0)
+      return -1;
   }
+  if (game_board->ships != NULL) {
+    Ship *ship = &game_board->ships[index];
+    memset(ship, 0, sizeof(*ship));
+    ship->position = position;
+    ship->size = ship_mode;
+    ship->direction = direction;
+  }
+  return 0;
+}
+
+/**
+ * @brief Marks the water around a ship as missed.
+ *
+ * No other ship can touch a sunk ship, so its halo is known water and never
+ * needs to be shot at.
+ *
+ * @param game_board Target Board
+ * @param ship Sunk Ship
+ * @return int number of fields newly marked, -1 when out of memory
+ */
+int board_halo(Board *game_board, const Ship *ship) {
+  int rows = ship->direction == 0 ? 1 : ship->size;
+  int cols = ship->direction == 0 ? ship->size : 1;
+  int count = 0;
+
+  for (int x = ship->position.row - 1; x <= ship->position.row + rows; x++) {
+    if (x < 0 || x >= game_board->game_range)
+      continue;
+    for (int y = ship->position.col - 1; y <= ship->position.col + cols; y++) {
+      if (y < 0 || y >= game_board->game_range)
+        continue;
+      Cell cell = board_cell(game_board, x, y);
+      if (cell.symbol == WATER) {
+        cell.symbol = MISS;
+        if (board_set(game_board, x, y, cell) != 0)
+          return -1;
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Picks a random valid position among all positions on the GameBoard.
+ *
+ * Finds a position whenever one exists. Dense boards map all positions at once with
+ * @c kernel_anchors(), other boards check every cell in both directions with the board kernel.
+ *
+ * @param game_board Target Board
+ * @param game_range Target Board Dimension
+ * @param size Ship Length
+ * @param index Ship ID on the Target Board
+ * @param pos Chosen Coordinates
+ * @param dir Chosen Direction
+ * @return true
+ * @return false no valid position left
+ */
+static bool board_scan(Board *game_board, int game_range, int size, int index, Coordinate *pos, int *dir) {
+  Coordinate cand;
+  long found = 0;
+  uint16_t anchors[2][KERNEL_RANGE];
+  int count = kernel_anchors(game_board, size, anchors);
+
+  if (count == 0)
+    return false;
+  if (count > 0) {
+    // every position is equally likely, take the k-th set bit
+    int k = inRange(0, count - 1);
+    for (int d = 0; d < 2; d++) {
+      for (int line = 0; line < game_range; line++) {
+        for (uint16_t bits = anchors[d][line]; bits != 0; bits &= bits - 1) {
+          if (k-- > 0)
+            continue;
+          int along = 0;
+          while (!(bits >> along & 1))
+            along++;
+          pos->row = d == 0 ? line : along;
+          pos->col = d == 0 ? along : line;
+          *dir = d;
+          return true;
+        }
+      }
+    }
+  }
+
+  for (cand.row = 0; cand.row < game_range; cand.row++) {
+    for (cand.col = 0; cand.col < game_range; cand.col++) {
+      for (int d = 0; d < 2; d++) {
+        if (!game_board->kernel->valid(game_board, cand, d, size, index))
+          continue;
+        // reservoir sampling keeps every valid position equally likely
+        if (inRange(0, (int)found++) == 0) {
+          *pos = cand;
+          *dir = d;
+        }
+      }
+    }
+  }
+  return found > 0;
 }
 
 /**
@@ -49,10 +333,14 @@ void board_fill(Cell **game_board, WaterCraft *ship_type, Coordinate position, i
  * 
  * Random Mode: Generates Coordinates @c genCoords() and sets position @c board_fill() 
  * after passing validation @c is_valid(). \n
- * Manual Mode: Coordinates based on user input from @c getTarget(). \n
+ * Manual Mode: Coordinates based on user input from @c getTarget(), with the number of
+ * positions left as a hint. \n
  * 
- * Reset Counter @c c resets board if @c isValid can't find a valid position after x tries. \n
- * Prevents endless loops when ships are placed too dense to each other.
+ * Reset Counter @c c falls back to @c board_scan() if @c isValid can't find a valid position
+ * after x tries, or after two on dense boards where the scan maps all positions at once.
+ * The board is only reset when a ship doesn't fit anywhere anymore, which happens when
+ * ships are placed too dense to each other. \n
+ * Gives up after @c PLACE_RESTARTS resets, so fleets that don't fit can't loop endlessly.
  * 
  * @param game_board Target Board
  * @param ship_type Ship Properties
@@ -60,27 +348,42 @@ void board_fill(Cell **game_board, WaterCraft *ship_type, Coordinate position, i
  * @param ship_mode Ship Length
  * @param ship_total Ship Counter
  * @param rng Generation Mode. 0 == random, 1 == manual
+ * @return int 0 on success, -1 if the fleet couldn't be placed or out of memory
  */
-void board_rand(Cell **game_board, WaterCraft *ship_type, int game_range, int *ship_mode, int ship_total, int rng) {
+int board_rand(Board *game_board, WaterCraft *ship_type, int game_range, int *ship_mode, int ship_total, int rng) {
   Coordinate pos;
 
   int dir = 0;
   int c = 0;
+  int restarts = 0;
   char dval[3], *vald;
+  uint16_t anchors[2][KERNEL_RANGE];
+  // the anchor map beats more than a couple of random tries
+  bool mapped = game_board->cells != NULL && game_range <= KERNEL_RANGE;
 
   for (int i = 0; i < ship_total; ++i) {
-    while (true) {
+    bool placed = false;
+    while (!placed) {
       if (rng == 0) {
         c++;
-        if (c > 10) {
-          board_clear(game_board, game_range);
-          board_rand(game_board, ship_type, game_range, ship_mode, ship_total, rng);
-          return;
+        if (c > (mapped ? 2 : 10)) {
+          c = 0;
+          if (!board_scan(game_board, game_range, ship_mode[i], i, &pos, &dir))
+            break;
+          placed = true;
+          continue;
         }
         dir = inRange(0, 1);
         pos = genCoords(dir, game_range, ship_mode[i]);
       } else {
-        printf("[%d/%d] Placing %s (%d cells); ", i + 1, ship_total, ship_type[ship_mode[i] - 2].name, ship_mode[i]);
+        int fits = kernel_anchors(game_board, ship_mode[i], anchors);
+        if (fits == 0) {
+          printf("No room left for the %s, starting over.\n", watercraft(ship_type, ship_mode[i])->name);
+          break;
+        }
+        if (fits > 0)
+          printf("%d positions fit. ", fits);
+        printf("[%d/%d] Placing %s (%d cells); ", i + 1, ship_total, watercraft(ship_type, ship_mode[i])->name, ship_mode[i]);
         pos = getTarget(game_range);
         printf("[1] HORIZONTAL\n");
         printf("[2] VERTICAL\n");
@@ -91,16 +394,24 @@ void board_rand(Cell **game_board, WaterCraft *ship_type, int game_range, int *s
         } while (dir <= 0 || dir > 2);
         dir -= 1;
       }
-      if (isvalid(game_board, pos, game_range, dir, ship_mode[i], i)) {
-        c = 0;
-        break;
-      }
+      placed = game_board->kernel->valid(game_board, pos, dir, ship_mode[i], i);
+    }
+    c = 0;
+    if (!placed) {
+      // no room left for this ship, start over
+      board_clear(game_board, game_range);
+      if (++restarts > PLACE_RESTARTS)
+        return -1;
+      i = -1;
+      continue;
     }
-    board_fill(game_board, ship_type, pos, ship_mode[i], dir, i);
+    if (board_fill(game_board, ship_type, pos, ship_mode[i], dir, i) != 0)
+      return -1;
     if (rng == 1) {
       board_print(game_board, game_board, game_range, true);
     }
   }
+  return 0;
 }
 
 /**
@@ -115,8 +426,9 @@ void board_rand(Cell **game_board, WaterCraft *ship_type, int game_range, int *s
  * @param player_total Player Counter (no CPU)
  * @param ship_mode Ship Length
  * @param ship_total Ship Counter
+ * @return int 0 on success, -1 if a fleet couldn't be placed
  */
-void board_diag(Cell **game_board, Cell **gameBoard2, WaterCraft *ship_type, int game_range, int player_total, int *ship_mode, int ship_total) {
+int board_diag(Board *game_board, Board *gameBoard2, WaterCraft *ship_type, int game_range, int player_total, int *ship_mode, int ship_total) {
   char tmp[3], *tmp_;
   int gen = 0;
 
@@ -133,13 +445,17 @@ void board_diag(Cell **game_board, Cell **gameBoard2, WaterCraft *ship_type, int
     }
 
     if (i == 0) {
-      board_rand(game_board, ship_type, game_range, ship_mode, ship_total, gen - 1);
+      if (board_rand(game_board, ship_type, game_range, ship_mode, ship_total, gen - 1) != 0)
+        return -1;
     } else {
-      board_rand(gameBoard2, ship_type, game_range, ship_mode, ship_total, gen - 1);
+      if (board_rand(gameBoard2, ship_type, game_range, ship_mode, ship_total, gen - 1) != 0)
+        return -1;
       continue;
     }
-    board_rand(gameBoard2, ship_type, game_range, ship_mode, ship_total, gen - 1);
+    if (board_rand(gameBoard2, ship_type, game_range, ship_mode, ship_total, gen - 1) != 0)
+      return -1;
   }
+  return 0;
 }
 
 /**
@@ -152,7 +468,7 @@ void board_diag(Cell **game_board, Cell **gameBoard2, WaterCraft *ship_type, int
  * @param game_range Target Board Dimension
  * @param show_all @c Debug Show all ships to both players
  */
-void board_printn(Cell **own, Cell **opp, int game_range, bool show_all) {
+void board_printn(Board *own, Board *opp, int game_range, bool show_all) {
   initscr();
 
   box(stdscr, '|', '~');
@@ -193,12 +509,12 @@ void board_printn(Cell **own, Cell **opp, int game_range, bool show_all) {
     for (int j = 0; j < game_range; j++) {
       nposx = 3 * (j + 1);
       // if (show_all == true) {
-      if (own[i][j].symbol == -1) {
+      if (board_cell(own, i, j).symbol == -1) {
         // MISS
         wattron(stdscr, COLOR_PAIR(2));
         mvwprintw(stdscr, nposy, nposx, "  m  ");
         wattroff(stdscr, COLOR_PAIR(2));
-      } else if (own[i][j].symbol == 1) {
+      } else if (board_cell(own, i, j).symbol == 1) {
         // HIT
         wattron(stdscr, COLOR_PAIR(3));
         mvwprintw(stdscr, nposy, nposx, "  x  ");
@@ -207,7 +523,7 @@ void board_printn(Cell **own, Cell **opp, int game_range, bool show_all) {
         // SHIP
         if (show_all == true) {
           wattron(stdscr, COLOR_PAIR(5));
-          mvwprintw(stdscr, nposy, nposx, "  %c  ", ship_syms[own[i][j].symbol]);
+          mvwprintw(stdscr, nposy, nposx, "  %c  ", ship_syms[board_cell(own, i, j).symbol]);
           wattroff(stdscr, COLOR_PAIR(5));
         } else {
           wattron(stdscr, COLOR_PAIR(1));
@@ -219,17 +535,17 @@ void board_printn(Cell **own, Cell **opp, int game_range, bool show_all) {
     for (int j = 0; j < game_range; j++) {
       nposx = 3 * (j + 1);
       mvwprintw(stdscr, nposy, offset, "%i", i + 1);
-      if (opp[i][j].symbol == 0) {
+      if (board_cell(opp, i, j).symbol == 0) {
         // WATER
         wattron(stdscr, COLOR_PAIR(1));
         mvwprintw(stdscr, nposy, offset + nposx, "  ~  ");
         wattroff(stdscr, COLOR_PAIR(1));
-      } else if (opp[i][j].symbol == -1) {
+      } else if (board_cell(opp, i, j).symbol == -1) {
         // MISS
         wattron(stdscr, COLOR_PAIR(2));
         mvwprintw(stdscr, nposy, offset + nposx, "  m  ");
         wattroff(stdscr, COLOR_PAIR(2));
-      } else if (opp[i][j].symbol == 1) {
+      } else if (board_cell(opp, i, j).symbol == 1) {
         // HIT
         wattron(stdscr, COLOR_PAIR(3));
         mvwprintw(stdscr, nposy, offset + nposx, "  x  ");
@@ -237,7 +553,7 @@ void board_printn(Cell **own, Cell **opp, int game_range, bool show_all) {
       } else {
         // SHIP
         wattron(stdscr, COLOR_PAIR(4));
-        mvwprintw(stdscr, nposy, offset + nposx, "  %c  ", ship_syms[opp[i][j].symbol]);
+        mvwprintw(stdscr, nposy, offset + nposx, "  %c  ", ship_syms[board_cell(opp, i, j).symbol]);
         wattroff(stdscr, COLOR_PAIR(4));
       }
     }
@@ -259,7 +575,7 @@ void board_printn(Cell **own, Cell **opp, int game_range, bool show_all) {
  * @param game_range Target Board Dimension
  * @param show_all @c Debug Show all ships to both players
  */
-void board_print(Cell **own, Cell **opp, int game_range, bool show_all) {
+void board_print(Board *own, Board *opp, int game_range, bool show_all) {
   char ship_syms[6] = {'~', 'x', 's', 'c', 'b', 'r'};
   printf("\n");
   printf("\tTARGET FIELD\t\t\t\t\t\t");
@@ -286,21 +602,21 @@ void board_print(Cell **own, Cell **opp, int game_range, bool show_all) {
     printf("%02d ", i + 1);
     for (int j = 0; j < game_range; ++j) {
       if (show_all == true) {
-        if (own[i][j].symbol == -1) {
+        if (board_cell(own, i, j).symbol == -1) {
           printf(" %c", 'm');
         } else {
-          if (DEBUG || own[i][j].symbol < 2) {
-            printf(" %c", ship_syms[own[i][j].symbol]);
+          if (DEBUG || board_cell(own, i, j).symbol < 2) {
+            printf(" %c", ship_syms[board_cell(own, i, j).symbol]);
           } else {
             printf(" ~");
           }
         }
       } else {
-        if (own[i][j].symbol == -1) {
+        if (board_cell(own, i, j).symbol == -1) {
           printf(" %c", 'm');
         } else {
-          if (own[i][j].symbol < 2) {
-            printf(" %c", ship_syms[own[i][j].symbol]);
+          if (board_cell(own, i, j).symbol < 2) {
+            printf(" %c", ship_syms[board_cell(own, i, j).symbol]);
           } else {
             printf(" ~");
           }
@@ -311,16 +627,16 @@ void board_print(Cell **own, Cell **opp, int game_range, bool show_all) {
     printf("%02d ", i + 1);
     for (int j = 0; j < game_range; ++j) {
       if (show_all == true) {
-        if (opp[i][j].symbol == -1) {
+        if (board_cell(opp, i, j).symbol == -1) {
           printf(" %c", 'm');
         } else {
-          printf(" %c", ship_syms[opp[i][j].symbol]);
+          printf(" %c", ship_syms[board_cell(opp, i, j).symbol]);
         }
       } else {
-        if (opp[i][j].symbol == -1) {
+        if (board_cell(opp, i, j).symbol == -1) {
           printf(" %c", 'm');
         } else {
-          printf(" %c", ship_syms[opp[i][j].symbol]);
+          printf(" %c", ship_syms[board_cell(opp, i, j).symbol]);
         }
       }
     }
@@ -10,9 +10,20 @@
 //#include <math.h>
 #include <ncurses.h>
 
+#include "sparse.h"
+
 #define DEBUG 0
 #define NCURS 1
 #define MAX_SHIPS 7
+#define MAX_RANGE 2048
+#define MAX_FLEET 65536
+/* full board restarts before random placement gives up */
+#define PLACE_RESTARTS 100
+/* largest board with a specialised kernel, occupancy rows fit 16 bit with padding */
+#define KERNEL_RANGE 13
+/* boards from this size on are stored sparse when ships cover less than 1/SPARSE_DENSITY of them */
+#define SPARSE_MIN_RANGE 256
+#define SPARSE_DENSITY 16
 
 #define HIT 1
 #define WATER 0
@@ -38,11 +49,57 @@ typedef struct cell {
     int symbol;
 } Cell;
 
-void board_clear(Cell **game_board, int game_range);
-void board_print(Cell **game_board, Cell **game_board2, int game_range, bool show_all);
-void board_printn(Cell **game_board, Cell **game_board2, int game_range, bool show_all);
-void board_diag(Cell **game_board, Cell **gameBoard2, WaterCraft *ship_type, int game_range, int player_total, int *ship_mode, int ship_total);
-void board_rand(Cell **game_board, WaterCraft *ship_type, int game_range, int *ship_mode, int ship_total, int mode);
-void board_fill(Cell **game_board, WaterCraft *ship_type, Coordinate position, int ship_mode, int direction, int index);
+/*
+ * Placed ship, written by board_fill(). Segments count from the anchor position along
+ * the direction (0 horizontal, 1 vertical). hit_mask tracks the first 64 segments,
+ * longer ships only count their hits.
+ */
+typedef struct ship {
+    Coordinate position;
+    int size;
+    int direction;
+    int hits;
+    int sunk;
+    uint32_t hit_mask[2];
+} Ship;
+
+struct kernel;
+
+/*
+ * GameBoard storage, access cells through board_cell() and board_set().
+ * Dense boards keep a Cell per field. Sparse boards only keep ship cells and fired
+ * cells in hash tables, so memory follows fleet size and shots instead of board area.
+ * Small dense boards also keep a bit per non water field, by rows and by columns,
+ * shifted by one so the halo of border fields needs no bounds checks.
+ * Dense boards log the fields that stop being water, so clearing a board only
+ * touches the fields the last game used.
+ */
+typedef struct board {
+    int game_range;
+    Cell **cells;
+    uint32_t *touched;
+    uint32_t touched_count;
+    /* placement and shot checks for this board, see kernel.h */
+    const struct kernel *kernel;
+    uint16_t occupancy[2][KERNEL_RANGE + 2];
+    Sparse segments;
+    Sparse shots;
+    /* ship table indexed by ship id, owned by the game, NULL if not tracked */
+    Ship *ships;
+} Board;
+
+int board_alloc(Board *game_board, int game_range, bool sparse);
+void board_free(Board *game_board);
+Cell board_cell(const Board *game_board, int row, int col);
+int board_set(Board *game_board, int row, int col, Cell cell);
+void board_clear(Board *game_board, int game_range);
+void board_occupancy(Board *game_board);
+void board_print(Board *game_board, Board *game_board2, int game_range, bool show_all);
+void board_printn(Board *game_board, Board *game_board2, int game_range, bool show_all);
+int board_diag(Board *game_board, Board *gameBoard2, WaterCraft *ship_type, int game_range, int player_total, int *ship_mode, int ship_total);
+int board_rand(Board *game_board, WaterCraft *ship_type, int game_range, int *ship_mode, int ship_total, int mode);
+WaterCraft *watercraft(WaterCraft *ship_type, int size);
+int board_halo(Board *game_board, const Ship *ship);
+int board_fill(Board *game_board, WaterCraft *ship_type, Coordinate position, int ship_mode, int direction, int index);
 
 #endif
@@ -0,0 +1,391 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdarg.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "broadcast.h"
+
+/* longest delta line of a single event */
+#define BROADCAST_LINE 48
+
+/**
+ * @brief Allocate an empty frame with one reference.
+ *
+ * @param size Room for the serialized lines
+ * @return Frame* NULL when out of memory
+ */
+static Frame *frame_alloc(int size) {
+  Frame *frame = malloc(sizeof(Frame) + size);
+
+  if (frame == NULL)
+    return NULL;
+  frame->refs = 1;
+  frame->len = 0;
+  return frame;
+}
+
+/**
+ * @brief Drop a reference to a frame, the last one frees it.
+ *
+ * @param frame Target Frame, may be NULL
+ */
+void frame_release(Frame *frame) {
+  if (frame != NULL && --frame->refs == 0)
+    free(frame);
+}
+
+/**
+ * @brief Append a formatted line to a frame.
+ *
+ * @param frame Target Frame
+ * @param size Room of the frame
+ * @param fmt Format String
+ */
+static void frame_printf(Frame *frame, int size, const char *fmt, ...) {
+  va_list args;
+  int room = size - frame->len;
+
+  va_start(args, fmt);
+  int n = vsnprintf(frame->data + frame->len, room, fmt, args);
+  va_end(args);
+  if (n > 0)
+    frame->len += n < room ? n : room - 1;
+}
+
+/**
+ * @brief Serialize the whole game as seen by a spectator.
+ *
+ * @param seq Sequence Number the snapshot stands for
+ * @param game Source Game, NULL while no game runs
+ * @return Frame* NULL when out of memory
+ */
+static Frame *frame_snapshot(unsigned int seq, const Game *game) {
+  int n = game != NULL ? game->game_range : 0;
+  int size = 40 + 2 * (n * n + 1);
+  Frame *frame = frame_alloc(size);
+
+  if (frame == NULL)
+    return NULL;
+  frame_printf(frame, size, "SNAP %u %d", seq, n);
+  for (int p = 0; p < 2; p++) {
+    char *fields = frame->data + frame->len;
+    // the fields of player p are on the board of the opponent
+    const Board *board = game != NULL ? &game->player[!p] : NULL;
+    *fields++ = ' ';
+    if (n == 0)
+      *fields++ = '-';
+    for (int r = 0; r < n; r++) {
+      for (int c = 0; c < n; c++) {
+        int symbol = board_cell(board, r, c).symbol;
+        *fields++ = symbol == HIT ? 'x' : symbol == MISS ? 'o' : '.';
+      }
+    }
+    frame->len = (int)(fields - frame->data);
+  }
+  frame->data[frame->len++] = '\n';
+  return frame;
+}
+
+/**
+ * @brief Queue a frame for a spectator by reference.
+ *
+ * The caller makes sure the ring has room.
+ *
+ * @param sub Target Subscriber
+ * @param frame Shared Frame
+ */
+static void sub_push(Subscriber *sub, Frame *frame) {
+  frame->refs++;
+  sub->ring[sub->tail++ % BROADCAST_RING] = frame;
+}
+
+/**
+ * @brief Drop the backlog of a spectator.
+ *
+ * A frame that is partly written stays queued, so the stream never breaks a line.
+ *
+ * @param sub Target Subscriber
+ */
+static void sub_drop(Subscriber *sub) {
+  unsigned int keep = sub->head + (sub->offset > 0);
+
+  while (sub->tail != keep) {
+    frame_release(sub->ring[--sub->tail % BROADCAST_RING]);
+  }
+}
+
+/**
+ * @brief Snapshot of the channel at its current sequence number.
+ *
+ * Built once per sequence number and shared by every spectator catching up.
+ *
+ * @param channel Source Channel
+ * @param game Source Game, NULL while no game runs
+ * @return Frame* NULL when out of memory
+ */
+static Frame *channel_snapshot(Channel *channel, const Game *game) {
+  if (channel->snapshot != NULL && channel->snapshot_seq == channel->seq)
+    return channel->snapshot;
+  frame_release(channel->snapshot);
+  channel->snapshot = frame_snapshot(channel->seq, game);
+  channel->snapshot_seq = channel->seq;
+  return channel->snapshot;
+}
+
+/**
+ * @brief Queue a frame for a spectator, a full ring is replaced by a snapshot.
+ *
+ * @param channel Source Channel
+ * @param sub Target Subscriber
+ * @param frame Shared Frame
+ * @param game Source Game for the snapshot
+ * @return int 0 on success, -1 when out of memory
+ */
+static int channel_queue(Channel *channel, Subscriber *sub, Frame *frame, const Game *game) {
+  if (sub->tail - sub->head < BROADCAST_RING) {
+    sub_push(sub, frame);
+    return 0;
+  }
+  // the snapshot already contains everything dropped
+  Frame *snapshot = channel_snapshot(channel, game);
+  if (snapshot == NULL)
+    return -1;
+  sub_drop(sub);
+  sub_push(sub, snapshot);
+  sub->lagged++;
+  return 0;
+}
+
+/**
+ * @brief Queue a snapshot for every spectator of a channel.
+ *
+ * @param channel Target Channel
+ * @param game Source Game, NULL while no game runs
+ * @return int 0 on success, -1 when out of memory
+ */
+static int channel_resync(Channel *channel, const Game *game) {
+  Frame *snapshot;
+
+  if (channel->subs == NULL)
+    return 0;
+  if ((snapshot = channel_snapshot(channel, game)) == NULL)
+    return -1;
+  for (Subscriber *sub = channel->subs; sub != NULL; sub = sub->next) {
+    sub_drop(sub);
+    sub_push(sub, snapshot);
+  }
+  return 0;
+}
+
+/**
+ * @brief Start a channel without spectators.
+ *
+ * @param channel Target Channel
+ */
+void broadcast_init(Channel *channel) {
+  memset(channel, 0, sizeof(*channel));
+}
+
+/**
+ * @brief Add a spectator to a channel.
+ *
+ * The spectator starts with the shared snapshot of the game, nothing is rendered for it.
+ *
+ * @param channel Target Channel
+ * @param sub Target Subscriber, its fd and owner are kept
+ * @param game Source Game, NULL while no game runs
+ * @return int 0 on success, -1 when out of memory
+ */
+int broadcast_subscribe(Channel *channel, Subscriber *sub, const Game *game) {
+  Frame *snapshot = channel_snapshot(channel, game);
+
+  if (snapshot == NULL)
+    return -1;
+  sub->head = sub->tail = 0;
+  sub->offset = 0;
+  sub->ended = false;
+  sub->lagged = 0;
+  sub_push(sub, snapshot);
+  sub->channel = channel;
+  sub->prev = NULL;
+  sub->next = channel->subs;
+  if (channel->subs != NULL)
+    channel->subs->prev = sub;
+  channel->subs = sub;
+  channel->count++;
+  return 0;
+}
+
+/**
+ * @brief Remove a spectator and drop its backlog.
+ *
+ * @param sub Target Subscriber
+ */
+void broadcast_unsubscribe(Subscriber *sub) {
+  Channel *channel = sub->channel;
+
+  while (sub->head != sub->tail) {
+    frame_release(sub->ring[sub->head++ % BROADCAST_RING]);
+  }
+  sub->offset = 0;
+  if (channel == NULL)
+    return;
+  if (sub->prev != NULL) {
+    sub->prev->next = sub->next;
+  } else {
+    channel->subs = sub->next;
+  }
+  if (sub->next != NULL)
+    sub->next->prev = sub->prev;
+  channel->count--;
+  sub->channel = NULL;
+}
+
+/**
+ * @brief Send the events of a turn to every spectator.
+ *
+ * The turn is serialized once into a shared frame, see @c Channel for the lines.
+ * Without spectators only the sequence number advances.
+ *
+ * @param channel Target Channel
+ * @param game Game the events happened in
+ * @param events Events of the turn, see @c engine_events()
+ * @param count Number of events
+ * @return int 0 on success, -1 when out of memory
+ */
+int broadcast_publish(Channel *channel, const Game *game, const Event *events, int count) {
+  int size = count * BROADCAST_LINE + 1, ret = 0;
+  unsigned int seq = ++channel->seq;
+
+  if (channel->subs == NULL || count == 0)
+    return 0;
+  Frame *frame = frame_alloc(size);
+  if (frame == NULL)
+    return channel_resync(channel, game);
+  for (int i = 0; i < count; i++) {
+    const Event *ev = &events[i];
+    const Ship *ship;
+    switch (ev->type) {
+    case EVENT_MISS:
+    case EVENT_HIT:
+      frame_printf(frame, size, "SHOT %u %d %d %d %s\n", seq, ev->player + 1, ev->target.row + 1, ev->target.col + 1,
+                   ev->type == EVENT_HIT ? "HIT" : "MISS");
+      break;
+    case EVENT_SUNK:
+      ship = &game->player[!ev->player].ships[ev->ship];
+      frame_printf(frame, size, "SUNK %u %d %d %d %d %c\n", seq, ev->player + 1, ship->position.row + 1,
+                   ship->position.col + 1, ship->size, ship->direction == 0 ? 'h' : 'v');
+      break;
+    case EVENT_WIN:
+      frame_printf(frame, size, "WIN %u %d\n", seq, ev->player + 1);
+      break;
+    }
+  }
+  if (frame->len == 0) {
+    frame_release(frame);
+    return 0;
+  }
+  for (Subscriber *sub = channel->subs; sub != NULL; sub = sub->next) {
+    if (channel_queue(channel, sub, frame, game) != 0)
+      ret = -1;
+  }
+  frame_release(frame);
+  return ret;
+}
+
+/**
+ * @brief Tell every spectator that a new game started.
+ *
+ * @param channel Target Channel
+ * @param game New Game, NULL while no game runs
+ * @return int 0 on success, -1 when out of memory
+ */
+int broadcast_reset(Channel *channel, const Game *game) {
+  channel->seq++;
+  return channel_resync(channel, game);
+}
+
+/**
+ * @brief End the stream of every spectator and release the channel.
+ *
+ * Spectators keep their backlog followed by END and are detached.
+ *
+ * @param channel Target Channel
+ */
+void broadcast_close(Channel *channel) {
+  int size = BROADCAST_LINE;
+  Frame *frame = frame_alloc(size);
+
+  if (frame != NULL)
+    frame_printf(frame, size, "END %u\n", channel->seq);
+  while (channel->subs != NULL) {
+    Subscriber *sub = channel->subs;
+    channel->subs = sub->next;
+    if (frame != NULL) {
+      if (sub->tail - sub->head == BROADCAST_RING)
+        sub_drop(sub);
+      sub_push(sub, frame);
+    }
+    sub->ended = true;
+    sub->channel = NULL;
+    sub->prev = sub->next = NULL;
+  }
+  channel->count = 0;
+  frame_release(frame);
+  frame_release(channel->snapshot);
+  channel->snapshot = NULL;
+}
+
+/**
+ * @brief Checks if a spectator has frames left to write.
+ *
+ * @param sub Source Subscriber
+ * @return true
+ * @return false
+ */
+bool broadcast_pending(const Subscriber *sub) {
+  return sub->head != sub->tail;
+}
+
+/**
+ * @brief Write queued frames of a spectator without blocking.
+ *
+ * Up to @c BROADCAST_IOV frames go out with a single writev().
+ *
+ * @param sub Target Subscriber
+ * @return int 0 if all was written, 1 if the socket is full, -1 on error
+ */
+int broadcast_flush(Subscriber *sub) {
+  struct iovec iov[BROADCAST_IOV];
+
+  while (sub->head != sub->tail) {
+    int count = 0;
+    for (unsigned int i = sub->head; i != sub->tail && count < BROADCAST_IOV; i++, count++) {
+      Frame *frame = sub->ring[i % BROADCAST_RING];
+      int skip = i == sub->head ? sub->offset : 0;
+      iov[count].iov_base = frame->data + skip;
+      iov[count].iov_len = frame->len - skip;
+    }
+    ssize_t n = writev(sub->fd, iov, count);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? 1 : -1;
+    }
+    while (n > 0) {
+      Frame *frame = sub->ring[sub->head % BROADCAST_RING];
+      int rest = frame->len - sub->offset;
+      if (n < rest) {
+        sub->offset += n;
+        break;
+      }
+      n -= rest;
+      sub->offset = 0;
+      sub->head++;
+      frame_release(frame);
+    }
+  }
+  return 0;
+}
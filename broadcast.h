@@ -0,0 +1,79 @@
+#include "engine.h"
+
+#ifndef BATTLESHIPS_BROADCAST_H
+#define BATTLESHIPS_BROADCAST_H
+
+/* frames queued per spectator before it falls back to a snapshot */
+#define BROADCAST_RING 64
+/* frames handed to one writev() */
+#define BROADCAST_IOV 16
+
+/*
+ * Serialized lines shared by all spectators of a game. A frame is written once and
+ * queued by reference, the last spectator to send it frees it.
+ */
+typedef struct frame {
+  int refs;
+  int len;
+  char data[];
+} Frame;
+
+struct channel;
+
+/*
+ * One spectator of a channel. Queuing a frame stores a pointer in a bounded ring.
+ * A spectator whose ring is full drops its backlog and catches up with a snapshot.
+ */
+typedef struct subscriber {
+  int fd;
+  /* watched game, NULL once it ended or before subscribing */
+  struct channel *channel;
+  struct subscriber *prev;
+  struct subscriber *next;
+  Frame *ring[BROADCAST_RING];
+  unsigned int head;
+  unsigned int tail;
+  /* bytes of the head frame already written */
+  int offset;
+  /* the game ended, close after the backlog is written */
+  bool ended;
+  long lagged;
+  /* owner of the subscription, e.g. the server session */
+  void *owner;
+} Subscriber;
+
+/*
+ * Spectators of one game. Every turn is one delta frame, one line per event:
+ *
+ *   SHOT <seq> <player> <row> <col> <MISS|HIT>
+ *   SUNK <seq> <player> <row> <col> <length> <h|v>   anchor of the ship sunk by the shot
+ *   WIN <seq> <player>
+ *
+ * New and lagging spectators get the whole game first:
+ *
+ *   SNAP <seq> <range> <fields of player 1> <fields of player 2>
+ *
+ * with the fields a player has shot at row by row, '.' not yet, 'o' missed, 'x' hit,
+ * or range 0 and '-' while no game runs. The water around sunk ships counts as
+ * missed. END <seq> closes the stream. Coordinates are 1 based like in the game.
+ */
+typedef struct channel {
+  unsigned int seq;
+  Subscriber *subs;
+  int count;
+  /* snapshot of the game at seq, shared by everyone catching up */
+  Frame *snapshot;
+  unsigned int snapshot_seq;
+} Channel;
+
+void frame_release(Frame *frame);
+void broadcast_init(Channel *channel);
+int broadcast_subscribe(Channel *channel, Subscriber *sub, const Game *game);
+void broadcast_unsubscribe(Subscriber *sub);
+int broadcast_publish(Channel *channel, const Game *game, const Event *events, int count);
+int broadcast_reset(Channel *channel, const Game *game);
+void broadcast_close(Channel *channel);
+bool broadcast_pending(const Subscriber *sub);
+int broadcast_flush(Subscriber *sub);
+
+#endif //BATTLESHIPS_BROADCAST_H
@@ -0,0 +1,217 @@
+#include "config.h"
+
+/**
+ * @brief Append ships to the fleet.
+ *
+ * @param config Target Config
+ * @param size Ship Length
+ * @param count Number of Ships
+ * @return int 0 on success, -1 when the fleet is too large or out of memory
+ */
+static int config_add(Config *config, int size, int count) {
+  if (count <= 0 || config->ship_total + count > MAX_FLEET)
+    return -1;
+  int *tmp = realloc(config->ship_mode, (config->ship_total + count) * sizeof(int));
+  if (tmp == NULL)
+    return -1;
+  config->ship_mode = tmp;
+  for (int i = 0; i < count; i++) {
+    config->ship_mode[config->ship_total++] = size;
+  }
+  return 0;
+}
+
+/**
+ * @brief Load one of the built-in game modes.
+ *
+ * @param config Target Config
+ * @param mode Game Mode 1-4
+ * @return int 0 on success, -1 for unknown modes
+ */
+int config_mode(Config *config, int mode) {
+  if (mode <= 0 || mode > GAME_MODES)
+    return -1;
+  config_free(config);
+  config->game_range = game_mode_range[mode - 1];
+  return config_finish(config);
+}
+
+/**
+ * @brief Set up board size and fleet from command line options.
+ *
+ * The fleet is a comma separated list of ship lengths, @c LxN adds N ships of length L,
+ * for example @c 5x10,4x20,3. An empty fleet derives the ships from the board size.
+ *
+ * @param config Target Config
+ * @param game_range Target Board Dimension
+ * @param fleet Fleet List or NULL
+ * @return int 0 on success, -1 on invalid input
+ */
+int config_fleet(Config *config, int game_range, const char *fleet) {
+  char *tmp_;
+
+  config_free(config);
+  config->game_range = game_range;
+  while (fleet != NULL && *fleet != '\0') {
+    long size = strtol(fleet, &tmp_, 10), count = 1;
+    if (tmp_ == fleet)
+      return -1;
+    if (*tmp_ == 'x') {
+      fleet = tmp_ + 1;
+      count = strtol(fleet, &tmp_, 10);
+      if (tmp_ == fleet)
+        return -1;
+    }
+    if (*tmp_ != ',' && *tmp_ != '\0')
+      return -1;
+    if (size <= 0 || size > MAX_RANGE || count > MAX_FLEET || config_add(config, (int)size, (int)count) != 0)
+      return -1;
+    fleet = *tmp_ == ',' ? tmp_ + 1 : tmp_;
+  }
+  return config_finish(config);
+}
+
+/**
+ * @brief Apply a configuration directive.
+ *
+ * Shared by configuration files and game scripts.
+ *
+ * @param config Target Config
+ * @param tokens Directive Tokens
+ * @param n Number of Tokens
+ * @param error Set to a message on errors
+ * @return int 1 if applied, 0 if it's not a configuration directive, -1 on errors
+ */
+int config_directive(Config *config, const Token *tokens, int n, const char **error) {
+  int value, count = 1;
+
+  if (script_is(tokens[0], "size")) {
+    if (n != 2 || !script_int(tokens[1], &value) || value <= 0 || value > MAX_RANGE) {
+      *error = "expected size <1-2048>";
+      return -1;
+    }
+    config->game_range = value;
+  } else if (script_is(tokens[0], "ship")) {
+    if (n < 2 || n > 3 || !script_int(tokens[1], &value) || value <= 0 || value > MAX_RANGE ||
+        (n == 3 && (!script_int(tokens[2], &count) || count <= 0))) {
+      *error = "expected ship <length> [count]";
+      return -1;
+    }
+    if (config_add(config, value, count) != 0) {
+      *error = "fleet too large";
+      return -1;
+    }
+  } else if (script_is(tokens[0], "salvo")) {
+    if (n != 1) {
+      *error = "expected salvo";
+      return -1;
+    }
+    config->salvo = true;
+  } else if (script_is(tokens[0], "mode")) {
+    if (n != 2 || !script_int(tokens[1], &value) || config_mode(config, value) != 0) {
+      *error = "mode must be 1-4";
+      return -1;
+    }
+  } else {
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief Validate a configuration and derive missing ships.
+ *
+ * Boards without a fleet get ceil(size / 2) ships from the built-in fleet like the
+ * built-in modes.
+ *
+ * @param config Target Config
+ * @return int 0 if the configuration can be played, -1 otherwise
+ */
+int config_finish(Config *config) {
+  if (config->game_range <= 0 || config->game_range > MAX_RANGE)
+    return -1;
+  if (config->ship_total == 0) {
+    // const int ship_total = (int)ceil((float)game_range / 2);
+    int ship_total = (config->game_range / 2) + ((config->game_range % 2) != 0);
+    for (int j = 0; j < ship_total; j++) {
+      int size = ship_mode_default[j % MAX_SHIPS];
+      if (config_add(config, size < config->game_range ? size : config->game_range, 1) != 0)
+        return -1;
+    }
+  }
+  for (int j = 0; j < config->ship_total; j++) {
+    if (config->ship_mode[j] > config->game_range)
+      return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Load board size and fleet from a configuration file.
+ *
+ * Errors are reported with their line number.
+ *
+ * @param config Target Config
+ * @param path Configuration File or @c -
+ * @return int 0 on success, -1 on errors
+ */
+int config_load(Config *config, const char *path) {
+  Script script;
+  Token tok[SCRIPT_TOKENS];
+  const char *error = NULL;
+  int n, ret = 0;
+
+  if (script_open(&script, path) != 0) {
+    fprintf(stderr, "Could not read configuration %s\n", path);
+    return -1;
+  }
+  config_free(config);
+  while (ret == 0 && (n = script_next(&script, tok, SCRIPT_TOKENS)) > 0) {
+    if (n > SCRIPT_TOKENS || config_directive(config, tok, n, &error) != 1) {
+      fprintf(stderr, "%s:%d: %s\n", path, script.line, error != NULL ? error : "unknown directive");
+      ret = -1;
+    }
+  }
+  if (ret == 0 && config_finish(config) != 0) {
+    fprintf(stderr, "%s: ships don't fit the board size\n", path);
+    ret = -1;
+  }
+  script_close(&script);
+  return ret;
+}
+
+/**
+ * @brief FNV-1a hash over board size, rules and fleet.
+ *
+ * Equal hashes mean the same games for the same seeds.
+ *
+ * @param config Source Config
+ * @return uint32_t
+ */
+uint32_t config_hash(const Config *config) {
+  int32_t values[3] = {config->game_range, config->salvo, config->ship_total};
+  uint32_t hash = FNV_BASIS;
+
+  for (int i = 0; i < 3 + config->ship_total; i++) {
+    uint32_t v = (uint32_t)(i < 3 ? values[i] : config->ship_mode[i - 3]);
+    // little endian on every machine, workers compare hashes over the network
+    unsigned char bytes[4] = {v & 0xff, v >> 8 & 0xff, v >> 16 & 0xff, v >> 24};
+    hash = fnv1a(hash, bytes, sizeof(bytes));
+  }
+  return hash;
+}
+
+/**
+ * @brief Release the fleet of a configuration.
+ *
+ * Layouts attached to the configuration are dropped but not released.
+ *
+ * @param config Target Config
+ */
+void config_free(Config *config) {
+  free(config->ship_mode);
+  config->ship_mode = NULL;
+  config->ship_total = 0;
+  // layouts belong to the fleet
+  config->layouts = NULL;
+}
@@ -0,0 +1,26 @@
+#include "script.h"
+
+#ifndef BATTLESHIPS_CONFIG_H
+#define BATTLESHIPS_CONFIG_H
+
+/*
+ * Configuration file, same syntax as scripts:
+ *
+ *   size <n>              board dimension, 1-MAX_RANGE
+ *   ship <length> [count] add ships to the fleet
+ *   mode <1-4>            built-in board size and fleet
+ *   salvo                 one shot per surviving ship each turn
+ *
+ * Without any ship directive the fleet is derived from the board size like the
+ * built-in modes do.
+ */
+
+int config_mode(Config *config, int mode);
+int config_fleet(Config *config, int game_range, const char *fleet);
+int config_directive(Config *config, const Token *tokens, int n, const char **error);
+int config_finish(Config *config);
+int config_load(Config *config, const char *path);
+uint32_t config_hash(const Config *config);
+void config_free(Config *config);
+
+#endif //BATTLESHIPS_CONFIG_H
@@ -0,0 +1,379 @@
+#include "engine.h"
+#include "kernel.h"
+#include "layout.h"
+
+/**
+ * @brief Derive the waiting state from the game.
+ *
+ * @param engine Target Engine
+ */
+static void engine_yield(Engine *engine) {
+  if (engine->state == ENGINE_OVER)
+    return;
+  engine->state = engine->cpu[engine->game.player_current] ? ENGINE_CPU : ENGINE_SHOT;
+}
+
+/**
+ * @brief Allocate the event and salvo buffers for the fleet.
+ *
+ * @param engine Target Engine, must not hold any buffers yet
+ * @return int 0 on success, -1 when out of memory
+ */
+static int engine_buffers(Engine *engine) {
+  // a salvo has at most one shot per ship, each shot reports up to three events
+  int shots = engine->game.salvo ? engine->game.ship_total : 1;
+  size_t events = engine->game.salvo ? 3 * (size_t)shots + 1 : ENGINE_EVENTS;
+
+  engine->events = malloc(events * sizeof(Event) + shots * (sizeof(Coordinate) + 2 * sizeof(int)));
+  if (engine->events == NULL)
+    return -1;
+  engine->salvo = (Coordinate *)(engine->events + events);
+  engine->salvo_hits = (int *)(engine->salvo + shots);
+  engine->salvo_sunk = engine->salvo_hits + shots;
+  return 0;
+}
+
+/**
+ * @brief Derive players and state of a game that is ready to be played.
+ *
+ * @param engine Target Engine
+ */
+static void engine_continue(Engine *engine) {
+  engine->cpu[0] = engine->game.player_total < 1;
+  engine->cpu[1] = engine->game.player_total < 2;
+  engine->event_count = 0;
+  engine->salvo_len = 0;
+  engine->state = game_won(&engine->game) ? ENGINE_OVER : ENGINE_SHOT;
+  engine_yield(engine);
+}
+
+/**
+ * @brief Allocate everything a game needs without starting it.
+ *
+ * The engine is left in @c ENGINE_OVER, start games with @c engine_restart().
+ *
+ * @param engine Target Engine
+ * @param config Board Size and Fleet
+ * @return int 0 on success, -1 when out of memory
+ */
+int engine_alloc(Engine *engine, const Config *config) {
+  if (game_init(&engine->game, config, 0) != 0)
+    return -1;
+  if (engine_buffers(engine) != 0) {
+    game_free(&engine->game);
+    return -1;
+  }
+  engine->event_count = 0;
+  engine->salvo_len = 0;
+  engine->state = ENGINE_OVER;
+  return 0;
+}
+
+/**
+ * @brief Start a new game in an engine that already holds one.
+ *
+ * Reuses boards and buffers, nothing is allocated. Places both fleets randomly, or from
+ * the layouts of the configuration when it has some.
+ * Player 1 is always human, player 2 is the CPU in a single player game. The first
+ * player is chosen randomly.
+ *
+ * @param engine Target Engine from @c engine_alloc() or @c engine_init()
+ * @param player_total Player Counter (no CPU), 0 lets the CPU play both sides
+ * @return int 0 on success, -1 if the fleet doesn't fit or out of memory
+ */
+int engine_restart(Engine *engine, int player_total) {
+  Game *game = &engine->game;
+
+  game_reset(game, player_total);
+  for (int p = 0; p < 2; p++) {
+    if (game->layouts != NULL) {
+      if (layout_place(game->layouts, &game->player[p], game->ship_mode) != 0) {
+        engine->state = ENGINE_OVER;
+        return -1;
+      }
+      continue;
+    }
+    if (board_rand(&game->player[p], ship_type_default, game->game_range, game->ship_mode, game->ship_total, 0) != 0) {
+      engine->state = ENGINE_OVER;
+      return -1;
+    }
+  }
+  game->player_current = inRange(0, 1);
+  engine_continue(engine);
+  return 0;
+}
+
+/**
+ * @brief Start a new game in caller provided memory.
+ *
+ * See @c engine_restart() for the setup of the game.
+ *
+ * @param engine Target Engine
+ * @param config Board Size and Fleet
+ * @param player_total Player Counter (no CPU), 0 lets the CPU play both sides
+ * @return int 0 on success, -1 when out of memory or the fleet doesn't fit
+ */
+int engine_init(Engine *engine, const Config *config, int player_total) {
+  if (engine_alloc(engine, config) != 0)
+    return -1;
+  if (engine_restart(engine, player_total) != 0) {
+    engine_release(engine);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Continue a game that has been set up or loaded into @c engine->game.
+ *
+ * Allocates the event and salvo buffers for the fleet, the engine must not hold any yet.
+ *
+ * @param engine Target Engine
+ * @return int 0 on success, -1 when out of memory
+ */
+int engine_resume(Engine *engine) {
+  if (engine_buffers(engine) != 0)
+    return -1;
+  engine_continue(engine);
+  return 0;
+}
+
+/**
+ * @brief Start a new game on the heap.
+ *
+ * @param config Board Size and Fleet
+ * @param player_total Player Counter (no CPU)
+ * @return Engine* NULL on errors, release with @c engine_destroy()
+ */
+Engine *engine_create(const Config *config, int player_total) {
+  Engine *engine = malloc(sizeof(Engine));
+
+  if (engine != NULL && engine_init(engine, config, player_total) != 0) {
+    free(engine);
+    return NULL;
+  }
+  return engine;
+}
+
+/**
+ * @brief Release the boards of an engine in caller provided memory.
+ *
+ * @param engine Target Engine
+ */
+void engine_release(Engine *engine) {
+  game_free(&engine->game);
+  free(engine->events);
+  engine->events = NULL;
+}
+
+/**
+ * @brief Release an engine from @c engine_create().
+ *
+ * @param engine Target Engine
+ */
+void engine_destroy(Engine *engine) {
+  if (engine == NULL)
+    return;
+  engine_release(engine);
+  free(engine);
+}
+
+/**
+ * @brief Push an event for the current turn.
+ *
+ * @param engine Target Engine
+ * @param type Event Type
+ * @param target Coordinates
+ * @param ship Ship ID
+ * @return Event* the new event
+ */
+static Event *engine_emit(Engine *engine, int type, Coordinate target, int ship) {
+  Event *ev = &engine->events[engine->event_count++];
+
+  ev->type = type;
+  ev->player = engine->game.player_current;
+  ev->target = target;
+  ev->ship = ship;
+  ev->count = 0;
+  return ev;
+}
+
+/**
+ * @brief Fire a salvo for whoever is on turn.
+ *
+ * Under classic rules a salvo is a single shot.
+ *
+ * @param engine Target Engine
+ * @param targets Coordinates
+ * @param count Number of targets
+ * @return int number of events, -1 if a field is out of range or already targeted,
+ *             or when out of memory, which ends the game
+ */
+static int engine_fire(Engine *engine, const Coordinate *targets, int count) {
+  Game *game = &engine->game;
+  SalvoResult result;
+  int ret = game_salvo(game, targets, count, engine->salvo_hits, engine->salvo_sunk, &result);
+
+  if (ret == -2)
+    engine->state = ENGINE_OVER;
+  if (ret != 0)
+    return -1;
+
+  engine->event_count = 0;
+  engine->salvo_len = 0;
+  game->game_round++;
+  if ((game->game_round % 2) == 1)
+    game->sub_round++;
+
+  for (int i = 0; i < count; i++) {
+    int sunk = engine->salvo_sunk[i];
+    engine_emit(engine, engine->salvo_hits[i] == 1 ? EVENT_HIT : EVENT_MISS, targets[i], -1);
+    if (sunk > -1) {
+      Event *reveal = engine_emit(engine, EVENT_REVEAL, targets[i], sunk);
+      if ((reveal->count = game_reveal(game, sunk)) < 0) {
+        engine->state = ENGINE_OVER;
+        return -1;
+      }
+      engine_emit(engine, EVENT_SUNK, targets[i], sunk);
+    }
+  }
+  if (result.won) {
+    engine_emit(engine, EVENT_WIN, targets[count - 1], -1);
+    game_finish(game);
+    engine->state = ENGINE_OVER;
+    return engine->event_count;
+  }
+  // alternate players
+  game->player_current = !game->player_current;
+  engine_yield(engine);
+  return engine->event_count;
+}
+
+/**
+ * @brief Submit a shot of the human player on turn.
+ *
+ * Under salvo rules the shots are collected until the salvo is complete and then
+ * fired together.
+ *
+ * @param engine Target Engine
+ * @param target Coordinates
+ * @return int number of events, 0 if the shot was added to an incomplete salvo,
+ *             -1 if no shot is expected, the field is invalid or out of memory
+ */
+int engine_submit(Engine *engine, Coordinate target) {
+  const Game *game = &engine->game;
+  const Board *board = &game->player[!game->player_current];
+
+  if (engine->state != ENGINE_SHOT)
+    return -1;
+  if (target.row < 0 || target.row >= game->game_range || target.col < 0 || target.col >= game->game_range ||
+      board->kernel->shot(board, target) == 0)
+    return -1;
+  for (int i = 0; i < engine->salvo_len; i++) {
+    if (engine->salvo[i].row == target.row && engine->salvo[i].col == target.col)
+      return -1;
+  }
+  engine->salvo[engine->salvo_len++] = target;
+  if (engine->salvo_len < game_salvo_size(game))
+    return 0;
+  return engine_fire(engine, engine->salvo, engine->salvo_len);
+}
+
+/**
+ * @brief Submit a whole salvo of the human player on turn.
+ *
+ * @param engine Target Engine
+ * @param targets Coordinates
+ * @param count Number of targets, must match @c game_salvo_size()
+ * @return int number of events, -1 if no salvo is expected, a field is invalid or out of memory
+ */
+int engine_salvo(Engine *engine, const Coordinate *targets, int count) {
+  if (engine->state != ENGINE_SHOT || count != game_salvo_size(&engine->game))
+    return -1;
+  engine->salvo_len = 0;
+  return engine_fire(engine, targets, count);
+}
+
+/**
+ * @brief Let the CPU on turn pick its targets without firing.
+ *
+ * Separates the decision from the shot, e.g. to time it. The next @c engine_step()
+ * fires the picked targets.
+ *
+ * @param engine Target Engine
+ * @return int number of targets, -1 if the CPU is not on turn or out of memory
+ */
+int engine_aim(Engine *engine) {
+  if (engine->state != ENGINE_CPU)
+    return -1;
+  if (engine->salvo_len == 0 && (engine->salvo_len = game_cpu_salvo(&engine->game, engine->salvo)) < 0) {
+    // out of memory ends the game
+    engine->salvo_len = 0;
+    engine->state = ENGINE_OVER;
+    return -1;
+  }
+  return engine->salvo_len;
+}
+
+/**
+ * @brief Let the CPU on turn take its shot or salvo.
+ *
+ * @param engine Target Engine
+ * @return int number of events, -1 if the CPU is not on turn or out of memory
+ */
+int engine_step(Engine *engine) {
+  int count = engine_aim(engine);
+
+  if (count < 0)
+    return -1;
+  return engine_fire(engine, engine->salvo, count);
+}
+
+/**
+ * @brief Events of the last shot.
+ *
+ * Valid until the next call of @c engine_submit() or @c engine_step().
+ *
+ * @param engine Target Engine
+ * @param count Number of events
+ * @return const Event*
+ */
+const Event *engine_events(const Engine *engine, int *count) {
+  *count = engine->event_count;
+  return engine->events;
+}
+
+/**
+ * @brief Prompts the events of the last shot on the console.
+ *
+ * @param engine Target Engine
+ */
+void engine_print(const Engine *engine) {
+  const Game *game = &engine->game;
+
+  for (int e = 0; e < engine->event_count; e++) {
+    const Event *ev = &engine->events[e];
+    switch (ev->type) {
+    case EVENT_HIT:
+      printf("(%d, %d) Target Hit!\n", ev->target.row + 1, ev->target.col + 1);
+      break;
+    case EVENT_MISS:
+      printf("(%d, %d) Target Miss!\n", ev->target.row + 1, ev->target.col + 1);
+      break;
+    case EVENT_SUNK:
+      printf(">>Target Destroyed [Player %d's %s ship (%d cells)]!\n",
+             !ev->player + 1, watercraft(ship_type_default, game->ship_mode[ev->ship])->size,
+             game->ship_mode[ev->ship]);
+      break;
+    case EVENT_WIN:
+      printf("\n> Player %d wins!\n", ev->player + 1);
+      break;
+    case EVENT_REVEAL:
+      if (DEBUG)
+        printf("(%d water fields revealed around the ship)\n", ev->count);
+      break;
+    default:
+      break;
+    }
+  }
+}
@@ -0,0 +1,68 @@
+#include "game.h"
+
+#ifndef BATTLESHIPS_ENGINE_H
+#define BATTLESHIPS_ENGINE_H
+
+/*
+ * Engine states. The engine yields whenever it needs a decision from outside.
+ */
+#define ENGINE_SHOT 0 /* waiting for a shot of the current human player, see engine_submit() */
+#define ENGINE_CPU 1  /* waiting for the CPU to be stepped, see engine_step() */
+#define ENGINE_OVER 2 /* the game has been won */
+
+/*
+ * Event types reported by a turn. EVENT_REVEAL comes right after the EVENT_HIT that
+ * sinks a ship, so the last event is always the outcome of the shot.
+ */
+#define EVENT_MISS 0
+#define EVENT_HIT 1
+#define EVENT_SUNK 2
+#define EVENT_WIN 3
+#define EVENT_REVEAL 4 /* water around the sunk ship marked as missed */
+
+/* events of a single shot: HIT, REVEAL, SUNK and WIN */
+#define ENGINE_EVENTS 4
+
+typedef struct event {
+  int type;
+  int player;
+  Coordinate target;
+  /* ship id for EVENT_SUNK and EVENT_REVEAL, -1 otherwise */
+  int ship;
+  /* fields revealed for EVENT_REVEAL */
+  int count;
+} Event;
+
+/*
+ * Reentrant game driver. Holds no global state, any number of engines can be
+ * driven side by side from a single thread.
+ * Under salvo rules a turn is a whole salvo and reports the events of all its shots.
+ */
+typedef struct engine {
+  Game game;
+  int state;
+  bool cpu[2];
+  Event *events;
+  int event_count;
+  /* salvo collected by engine_submit() and the results of its shots */
+  Coordinate *salvo;
+  int *salvo_hits;
+  int *salvo_sunk;
+  int salvo_len;
+} Engine;
+
+int engine_alloc(Engine *engine, const Config *config);
+int engine_restart(Engine *engine, int player_total);
+int engine_init(Engine *engine, const Config *config, int player_total);
+int engine_resume(Engine *engine);
+Engine *engine_create(const Config *config, int player_total);
+void engine_release(Engine *engine);
+void engine_destroy(Engine *engine);
+int engine_submit(Engine *engine, Coordinate target);
+int engine_salvo(Engine *engine, const Coordinate *targets, int count);
+int engine_aim(Engine *engine);
+int engine_step(Engine *engine);
+const Event *engine_events(const Engine *engine, int *count);
+void engine_print(const Engine *engine);
+
+#endif //BATTLESHIPS_ENGINE_H
@@ -0,0 +1,379 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <sys/mman.h>
+
+#include "game.h"
+#include "kernel.h"
+
+const int game_mode_range[GAME_MODES] = {DEBUG ? 2 : 5, 7, 10, 13};
+
+const int ship_mode_default[MAX_SHIPS] = {2, 2, 3, 3, 4, 5, 4};
+
+WaterCraft ship_type_default[4] = {
+    {2, 's', "small", "Submarine"},
+    {3, 'c', "medium", "Cruiser"},
+    {4, 'b', "large", "Battleship"},
+    {5, 'r', "huge", "Carrier"},
+};
+
+/**
+ * @brief Allocates both GameBoards of a game.
+ *
+ * Allocates and clears the board for both players, see @c board_alloc().
+ * Ship tables are left to the caller.
+ *
+ * @param game Target Game
+ * @param game_range Target Board Dimension
+ * @param sparse Use the sparse board storage
+ * @return int 0 on success, -1 when out of memory
+ */
+int game_alloc(Game *game, int game_range, bool sparse) {
+  game->game_range = game_range;
+  game->mapping = NULL;
+  game->mapping_size = 0;
+  memset(game->player, 0, sizeof(game->player));
+  game->ship_mode = NULL;
+
+  for (int p = 0; p < 2; p++) {
+    if (board_alloc(&game->player[p], game_range, sparse) != 0) {
+      game_free(game);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Releases both GameBoards and the ship tables of a game.
+ *
+ * Games loaded from a snapshot point into the mapped file and are unmapped instead.
+ *
+ * @param game Target Game
+ */
+void game_free(Game *game) {
+  for (int p = 0; p < 2; p++) {
+    if (game->mapping != NULL) {
+      // rows point into the mapping, only the first dimension is ours
+      free(game->player[p].cells);
+      game->player[p].cells = NULL;
+    } else {
+      board_free(&game->player[p]);
+    }
+  }
+  if (game->mapping != NULL) {
+    munmap(game->mapping, game->mapping_size);
+    game->mapping = NULL;
+    game->mapping_size = 0;
+  } else {
+    free(game->ship_mode);
+  }
+  if (game->salvo_set.keys != NULL)
+    sparse_free(&game->salvo_set);
+  game->ship_mode = NULL;
+}
+
+/**
+ * @brief Sets up the ship counters of a new game.
+ *
+ * Allocates the boards and loads the fleet of the configuration. Large boards the
+ * fleet covers only thinly are stored sparse.
+ * Ship placement is left to the caller.
+ *
+ * @param game Target Game
+ * @param config Board Size and Fleet
+ * @param player_total Player Counter (no CPU)
+ * @return int 0 on success, -1 when out of memory
+ */
+int game_init(Game *game, const Config *config, int player_total) {
+  long ship_cells = 0;
+
+  memset(game, 0, sizeof(*game));
+  for (int j = 0; j < config->ship_total; ++j) {
+    ship_cells += config->ship_mode[j];
+  }
+  bool sparse = config->game_range >= SPARSE_MIN_RANGE &&
+                ship_cells * SPARSE_DENSITY < (long)config->game_range * config->game_range;
+  if (game_alloc(game, config->game_range, sparse) != 0) {
+    return -1;
+  }
+  game->ship_total = config->ship_total;
+  game->salvo = config->salvo;
+  game->layouts = config->layouts;
+  if (game->salvo && sparse_init(&game->salvo_set, 0) != 0) {
+    game_free(game);
+    return -1;
+  }
+  // lengths and both ship tables in one block
+  game->ship_mode = malloc((size_t)config->ship_total * (sizeof(int) + 2 * sizeof(Ship)));
+  if (game->ship_mode == NULL) {
+    game_free(game);
+    return -1;
+  }
+  game->player[0].ships = (Ship *)(game->ship_mode + config->ship_total);
+  game->player[1].ships = game->player[0].ships + config->ship_total;
+  for (int j = 0; j < config->ship_total; ++j) {
+    game->ship_mode[j] = config->ship_mode[j];
+    game->hit_total += config->ship_mode[j];
+  }
+  game_reset(game, player_total);
+  return 0;
+}
+
+/**
+ * @brief Starts a new game with the boards and fleet of a finished one.
+ *
+ * Nothing is allocated. The boards are cleared, see @c board_clear(), and counters,
+ * stats and ship tables start over. Ship placement is left to the caller.
+ *
+ * @param game Target Game from @c game_init()
+ * @param player_total Player Counter (no CPU)
+ */
+void game_reset(Game *game, int player_total) {
+  game->player_total = player_total;
+  game->player_current = 0;
+  game->game_round = 0;
+  game->sub_round = 1;
+  memset(game->pstats_, 0, sizeof(game->pstats_));
+  for (int p = 0; p < 2; p++) {
+    board_clear(&game->player[p], game->game_range);
+    memset(game->player[p].ships, 0, game->ship_total * sizeof(Ship));
+    game->hit_count[p] = 0;
+    game->ships_left[p] = game->ship_total;
+    game->fields_left[p] = (long)game->game_range * game->game_range;
+  }
+}
+
+/**
+ * @brief Books a hit on a ship of the opponent.
+ *
+ * @param game Target Game
+ * @param board Opponent Board
+ * @param target Coordinates
+ * @param hitship Ship ID of the hit field
+ * @return int ship id if the hit sank the ship, -1 otherwise
+ */
+static int game_hit(Game *game, Board *board, Coordinate target, int hitship) {
+  if (hitship < 0)
+    return -1;
+  Ship *ship = &board->ships[hitship];
+  int segment = ship->direction == 0 ? target.col - ship->position.col : target.row - ship->position.row;
+  if (segment < 64)
+    ship->hit_mask[segment / 32] |= 1u << (segment % 32);
+  if (++ship->hits < ship->size)
+    return -1;
+  ship->sunk = 1;
+  game->ships_left[!game->player_current]--;
+  return hitship;
+}
+
+/**
+ * @brief Fires a shot of the current player at the opponent.
+ *
+ * Applies the shot to the opponent board and updates hit counters, the hit ship and
+ * player stats. Already targeted fields are rejected without changes.
+ *
+ * @param game Target Game
+ * @param target Coordinates
+ * @param sunk Set to the ship id destroyed by this shot, -1 otherwise
+ * @return int hit type like @c checkShot(), -2 when out of memory
+ */
+int game_shot(Game *game, Coordinate target, int *sunk) {
+  int player = game->player_current;
+  Board *board = &game->player[!player];
+  int hitype = board->kernel->shot(board, target);
+  Cell cell = board_cell(board, target.row, target.col);
+
+  *sunk = -1;
+  if (hitype == 0)
+    return 0;
+
+  game->pstats_[player].shots++;
+  game->fields_left[!player]--;
+  if (hitype == 1) {
+    *sunk = game_hit(game, board, target, cell.shipid);
+    game->hit_count[player]++;
+    game->pstats_[player].hit++;
+  } else {
+    game->pstats_[player].miss++;
+  }
+  // update board symbol
+  cell.symbol = hitype;
+  if (board_set(board, target.row, target.col, cell) != 0)
+    return -2;
+  return hitype;
+}
+
+/**
+ * @brief Number of shots the current player fires per turn.
+ *
+ * @param game Source Game
+ * @return int one per surviving ship under salvo rules but no more than fields are left, 1 otherwise
+ */
+int game_salvo_size(const Game *game) {
+  if (!game->salvo)
+    return 1;
+  int count = game->ships_left[game->player_current];
+  return count < game->fields_left[!game->player_current] ? count : (int)game->fields_left[!game->player_current];
+}
+
+/**
+ * @brief Fires a whole salvo of the current player at the opponent.
+ *
+ * All targets are checked first, a salvo with a target out of range, already targeted
+ * or named twice is rejected without changes. The shots are then applied in one pass
+ * and the counters and stats are updated once for the whole salvo.
+ *
+ * @param game Target Game
+ * @param targets Coordinates
+ * @param count Number of targets, at most @c game_salvo_size()
+ * @param hitypes Hit type per target like @c checkShot(), may be NULL
+ * @param sunk Ship id sunk by each target or -1, may be NULL
+ * @param result Hits, sunk ships and whether the salvo won the game
+ * @return int 0 on success, -1 if the salvo is invalid, -2 when out of memory
+ */
+int game_salvo(Game *game, const Coordinate *targets, int count, int *hitypes, int *sunk, SalvoResult *result) {
+  int player = game->player_current;
+  Board *board = &game->player[!player];
+
+  if (count <= 0 || count > game_salvo_size(game))
+    return -1;
+  if (count > 1)
+    sparse_reset(&game->salvo_set);
+  for (int i = 0; i < count; i++) {
+    Coordinate t = targets[i];
+    if (t.row < 0 || t.row >= game->game_range || t.col < 0 || t.col >= game->game_range ||
+        board->kernel->shot(board, t) == 0)
+      return -1;
+    if (count > 1) {
+      uint32_t key = (uint32_t)t.row * game->game_range + t.col;
+      int32_t first;
+      if (sparse_get(&game->salvo_set, key, &first))
+        return -1;
+      if (sparse_put(&game->salvo_set, key, i) != 0)
+        return -2;
+    }
+  }
+
+  memset(result, 0, sizeof(*result));
+  for (int i = 0; i < count; i++) {
+    Cell cell = board_cell(board, targets[i].row, targets[i].col);
+    // checked above, the field is either water or an intact ship segment
+    int hitype = cell.symbol == WATER ? -1 : 1;
+    int hitship = -1;
+    if (hitype == 1) {
+      result->hits++;
+      if ((hitship = game_hit(game, board, targets[i], cell.shipid)) > -1)
+        result->sunk_count++;
+    }
+    cell.symbol = hitype;
+    if (board_set(board, targets[i].row, targets[i].col, cell) != 0)
+      return -2;
+    if (hitypes != NULL)
+      hitypes[i] = hitype;
+    if (sunk != NULL)
+      sunk[i] = hitship;
+  }
+  game->hit_count[player] += result->hits;
+  game->pstats_[player].shots += count;
+  game->fields_left[!player] -= count;
+  game->pstats_[player].hit += result->hits;
+  game->pstats_[player].miss += count - result->hits;
+  result->won = game_won(game);
+  return 0;
+}
+
+/**
+ * @brief Marks the water around a sunk ship of the opponent as known.
+ *
+ * The fields count as missed, so neither player nor CPU waste shots on them.
+ *
+ * @param game Target Game
+ * @param ship Ship ID on the opponent board, as reported by @c game_shot()
+ * @return int number of fields revealed, -1 when out of memory
+ */
+int game_reveal(Game *game, int ship) {
+  Board *board = &game->player[!game->player_current];
+
+  int count = board_halo(board, &board->ships[ship]);
+
+  if (count < 0)
+    return -1;
+  game->fields_left[!game->player_current] -= count;
+  return count;
+}
+
+/**
+ * @brief Picks a CPU target that hasn't been shot at yet.
+ *
+ * @param game Target Game
+ * @return Coordinate
+ */
+Coordinate game_cpu_target(const Game *game) {
+  const Board *board = &game->player[!game->player_current];
+  Coordinate target;
+  int direct;
+
+  do {
+    direct = inRange(0, 1);
+    target = genCoords(direct, game->game_range - 1, 0);
+  } while (board->kernel->shot(board, target) == 0);
+  return target;
+}
+
+/**
+ * @brief Picks a whole CPU salvo of distinct targets that haven't been shot at yet.
+ *
+ * Every surviving ship of the opponent has an intact segment left, so there are
+ * always enough fields for a full salvo.
+ *
+ * @param game Target Game
+ * @param targets Target Coordinates, room for @c game_salvo_size() entries
+ * @return int number of targets, -1 when out of memory
+ */
+int game_cpu_salvo(Game *game, Coordinate *targets) {
+  int count = game_salvo_size(game);
+
+  if (count == 1) {
+    targets[0] = game_cpu_target(game);
+    return 1;
+  }
+  sparse_reset(&game->salvo_set);
+  for (int i = 0; i < count; i++) {
+    uint32_t key;
+    int32_t first;
+    do {
+      targets[i] = game_cpu_target(game);
+      key = (uint32_t)targets[i].row * game->game_range + targets[i].col;
+    } while (sparse_get(&game->salvo_set, key, &first));
+    if (sparse_put(&game->salvo_set, key, i) != 0)
+      return -1;
+  }
+  return count;
+}
+
+/**
+ * @brief Checks if the current player has sunk the whole opponent fleet.
+ *
+ * @param game Target Game
+ * @return true
+ * @return false
+ */
+bool game_won(const Game *game) {
+  return game->hit_count[game->player_current] == game->hit_total;
+}
+
+/**
+ * @brief Books the end of a game won by the current player into the stats.
+ *
+ * @param game Target Game
+ */
+void game_finish(Game *game) {
+  Stats *pstats_ = game->pstats_;
+
+  pstats_[game->player_current].won++;
+  pstats_[!game->player_current].lost++;
+  for (int c = 0; c < 2; c++) {
+    pstats_[c].total++;
+    pstats_[c].ratio = (pstats_[c].hit == 0 ? 0.0 : (double)pstats_[c].hit / (double)pstats_[c].shots);
+  }
+}
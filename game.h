@@ -0,0 +1,80 @@
+#include "battleship.h"
+#include "helpers.h"
+
+#ifndef BATTLESHIPS_GAME_H
+#define BATTLESHIPS_GAME_H
+
+/*
+ * Board size and fleet of a game.
+ */
+typedef struct config {
+  int game_range;
+  int ship_total;
+  int *ship_mode;
+  /* salvo rules: one shot per surviving ship each turn */
+  bool salvo;
+  /* layouts to start games from, see layout.h; NULL places fleets randomly */
+  const struct layouts *layouts;
+} Config;
+
+/*
+ * Outcome of a whole salvo.
+ */
+typedef struct salvo_result {
+  int hits;
+  int sunk_count;
+  bool won;
+} SalvoResult;
+
+/*
+ * Complete state of a running game.
+ * Everything needed to continue a game lives here, so it can be saved and resumed.
+ */
+typedef struct game {
+  int game_range;
+  int ship_total;
+  int hit_total;
+  int player_total;
+  int player_current;
+  int game_round;
+  int sub_round;
+  int hit_count[2];
+  int salvo;
+  /* ships not sunk yet and fields not shot at or revealed yet per board */
+  int ships_left[2];
+  long fields_left[2];
+  /* targets of the salvo being checked, salvo rules only */
+  Sparse salvo_set;
+  /* ship lengths, ship_total entries; the ship tables of both boards follow in the same block */
+  int *ship_mode;
+  /* layouts of the configuration, NULL places fleets randomly */
+  const struct layouts *layouts;
+  Stats pstats_[2];
+  /* player[0] holds the ships of player 1, player[1] the ships of player 2 */
+  Board player[2];
+  /* set when cells and ship tables live inside a snapshot mapping instead of the heap */
+  void *mapping;
+  size_t mapping_size;
+} Game;
+
+#define GAME_MODES 4
+
+/* built-in board sizes, fleet and ship properties */
+extern const int game_mode_range[GAME_MODES];
+extern const int ship_mode_default[MAX_SHIPS];
+extern WaterCraft ship_type_default[4];
+
+int game_alloc(Game *game, int game_range, bool sparse);
+void game_free(Game *game);
+int game_init(Game *game, const Config *config, int player_total);
+void game_reset(Game *game, int player_total);
+int game_shot(Game *game, Coordinate target, int *sunk);
+int game_salvo_size(const Game *game);
+int game_salvo(Game *game, const Coordinate *targets, int count, int *hitypes, int *sunk, SalvoResult *result);
+int game_cpu_salvo(Game *game, Coordinate *targets);
+int game_reveal(Game *game, int ship);
+Coordinate game_cpu_target(const Game *game);
+bool game_won(const Game *game);
+void game_finish(Game *game);
+
+#endif //BATTLESHIPS_GAME_H
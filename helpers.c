@@ -34,7 +34,7 @@ Coordinate getTarget(int game_range) {
   target.row = 0;
   target.col = 0;
   printf("Please enter coordinates (1-%d,1-%d):\n", game_range, game_range);
-  char tmp[10], *tmp_;
+  char tmp[LBUFFER], *tmp_;
 
   do {
     fgets(tmp, sizeof(tmp), stdin);
@@ -69,6 +69,26 @@ int inRange(int lower, int upper) {
   return (rand() % (upper - lower + 1)) + lower;
 }
 
+/**
+ * @brief FNV-1a hash over a block of memory.
+ *
+ * Checksums of snapshot and layout files and the hashes of configurations and
+ * arrangement profiles all go through here.
+ *
+ * @param hash Running hash, start with @c FNV_BASIS
+ * @param data Block to add
+ * @param len Block length in bytes
+ * @return uint32_t updated hash
+ */
+uint32_t fnv1a(uint32_t hash, const void *data, size_t len) {
+  const unsigned char *p = data;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= p[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
 /**
  * @brief Returns hit type of targeted GameBoard field.
  * 
@@ -76,9 +96,9 @@ int inRange(int lower, int upper) {
  * @param target Coordinates
  * @return int 
  */
-int checkShot(Cell **gameBoard, Coordinate target) {
+int checkShot(const Board *gameBoard, Coordinate target) {
   int hit;
-  switch (gameBoard[target.row][target.col].symbol) {
+  switch (board_cell(gameBoard, target.row, target.col).symbol) {
   case WATER:
     hit = -1;
     break;
@@ -97,6 +117,21 @@ int checkShot(Cell **gameBoard, Coordinate target) {
   return hit;
 }
 
+/**
+ * @brief Checks if a field blocks a ship.
+ *
+ * @param gameBoard Target Board
+ * @param x Row
+ * @param y Column
+ * @param index Ship ID on the Target Board
+ * @return true field holds another ship
+ * @return false
+ */
+static bool occupied(const Board *gameBoard, int x, int y, int index) {
+  Cell cell = board_cell(gameBoard, x, y);
+  return cell.symbol != WATER && cell.shipid != index;
+}
+
 /**
  * @brief Verify ship coordinates.
  * 
@@ -118,7 +153,7 @@ int checkShot(Cell **gameBoard, Coordinate target) {
  * @return true 
  * @return false 
  */
-bool isvalid(Cell **gameBoard, Coordinate position, int game_range, int direction, int size, int index) {
+bool isvalid(const Board *gameBoard, Coordinate position, int game_range, int direction, int size, int index) {
   for (int i = 0; i < size; i++) {
     if (direction == 0) { /*HORIZONTAL*/
       int x = position.row;
@@ -127,50 +162,41 @@ bool isvalid(Cell **gameBoard, Coordinate position, int game_range, int directio
       if (y >= game_range)
         return false;
       // EAST LEADING
-      if ((*(gameBoard + x) + y)->symbol != WATER &&
-          (*(gameBoard + x) + y)->shipid != index)
+      if (occupied(gameBoard, x, y, index))
         return false;
       if (y + 1 < game_range) {
-        if ((*(gameBoard + x) + y + 1)->symbol != WATER &&
-            (*(gameBoard + x) + y + 1)->shipid != index)
+        if (occupied(gameBoard, x, y + 1, index))
           return false;
       }
       // NORTH
       if (x - 1 >= 0) {
-        if ((*(gameBoard + x - 1) + y)->symbol != WATER &&
-            (*(gameBoard + x - 1) + y)->shipid != index)
+        if (occupied(gameBoard, x - 1, y, index))
           return false;
         if (y + 1 < game_range) {
-          if ((*(gameBoard + x - 1) + y + 1)->symbol != WATER &&
-              (*(gameBoard + x - 1) + y + 1)->shipid != index)
+          if (occupied(gameBoard, x - 1, y + 1, index))
             return false;
         }
       }
       // SOUTH
       if (x + 1 < game_range) {
-        if ((*(gameBoard + x + 1) + y)->symbol != WATER &&
-            (*(gameBoard + x + 1) + y)->shipid != index)
+        if (occupied(gameBoard, x + 1, y, index))
           return false;
         if (y + 1 < game_range) {
-          if ((*(gameBoard + x + 1) + y + 1)->symbol != WATER &&
-              (*(gameBoard + x + 1) + y + 1)->shipid != index)
+          if (occupied(gameBoard, x + 1, y + 1, index))
             return false;
         }
       }
       // WEST
       if (position.col - 1 >= 0 && x - 1 >= 0) {
-        if ((*(gameBoard + x - 1) + position.col - 1)->symbol != WATER &&
-            (*(gameBoard + x - 1) + position.col - 1)->shipid != index)
+        if (occupied(gameBoard, x - 1, position.col - 1, index))
           return false;
       }
       if (position.col - 1 >= 0) {
-        if ((*(gameBoard + x) + position.col - 1)->symbol != WATER &&
-            (*(gameBoard + x) + position.col - 1)->shipid != index)
+        if (occupied(gameBoard, x, position.col - 1, index))
           return false;
       }
       if (position.col - 1 >= 0 && x + 1 < game_range) {
-        if ((*(gameBoard + x + 1) + position.col - 1)->symbol != WATER &&
-            (*(gameBoard + x + 1) + position.col - 1)->shipid != index)
+        if (occupied(gameBoard, x + 1, position.col - 1, index))
           return false;
       }
 
@@ -181,49 +207,40 @@ bool isvalid(Cell **gameBoard, Coordinate position, int game_range, int directio
       if (x >= game_range)
         return false;
       // SOUTH LEADING
-      if ((*(gameBoard + x) + y)->symbol != WATER &&
-          (*(gameBoard + x) + y)->shipid != index)
+      if (occupied(gameBoard, x, y, index))
         return false;
       if (x + 1 < game_range) {
-        if ((*(gameBoard + x + 1) + y)->symbol != WATER &&
-            (*(gameBoard + x + 1) + y)->shipid != index)
+        if (occupied(gameBoard, x + 1, y, index))
           return false;
       }
       // NORTH
       if (position.row - 1 >= 0 && y - 1 >= 0) {
-        if ((*(gameBoard + position.row - 1) + y - 1)->symbol != WATER &&
-            (*(gameBoard + position.row - 1) + y - 1)->shipid != index)
+        if (occupied(gameBoard, position.row - 1, y - 1, index))
           return false;
       }
       if (position.row - 1 >= 0) {
-        if ((*(gameBoard + position.row - 1) + y)->symbol != WATER &&
-            (*(gameBoard + position.row - 1) + y)->shipid != index)
+        if (occupied(gameBoard, position.row - 1, y, index))
           return false;
         if (y + 1 < game_range) {
-          if ((*(gameBoard + position.row - 1) + y + 1)->symbol != WATER &&
-              (*(gameBoard + position.row - 1) + y + 1)->shipid != index)
+          if (occupied(gameBoard, position.row - 1, y + 1, index))
             return false;
         }
       }
       // EAST
       if (y + 1 < game_range) {
-        if ((*(gameBoard + x) + y + 1)->symbol != WATER &&
-            (*(gameBoard + x) + y + 1)->shipid != index)
+        if (occupied(gameBoard, x, y + 1, index))
           return false;
         if (x + 1 < game_range) {
-          if ((*(gameBoard + x + 1) + y + 1)->symbol != WATER &&
-              (*(gameBoard + x + 1) + y + 1)->shipid != index)
+          if (occupied(gameBoard, x + 1, y + 1, index))
             return false;
         }
       }
       // WEST
       if (y - 1 >= 0) { // check out of bounds
-        if ((*(gameBoard + x) + y - 1)->symbol != WATER &&
-            (*(gameBoard + x) + y - 1)->shipid != index)
+        if (occupied(gameBoard, x, y - 1, index))
           return false;
         if (x + 1 < game_range) {
-          if ((*(gameBoard + x + 1) + y - 1)->symbol != WATER &&
-              (*(gameBoard + x + 1) + y - 1)->shipid != index)
+          if (occupied(gameBoard, x + 1, y - 1, index))
             return false;
         }
       }
@@ -377,4 +394,4 @@ void parseStats(Stats pstats_[2]) {
   writeStats(pstats_);
 
   printf("> Updated stats.\n");
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -28,11 +28,15 @@ typedef struct stats {
 #define WON 5
 #define LOST 6
 
+/* FNV-1a offset basis, the hash of no data */
+#define FNV_BASIS 2166136261u
+
 Coordinate getTarget(int game_range);
 Coordinate genCoords(int direction, int game_range, int offset);
-bool isvalid(Cell **gameBoard, Coordinate position, int game_range, int direction, int size, int index);
-int checkShot(Cell **gameBoard, Coordinate target);
+bool isvalid(const Board *gameBoard, Coordinate position, int game_range, int direction, int size, int index);
+int checkShot(const Board *gameBoard, Coordinate target);
 int inRange(int lower, int upper);
+uint32_t fnv1a(uint32_t hash, const void *data, size_t len);
 void parseStats(Stats gameStats[2]);
 void writeStats(Stats gameStats[2]);
 
@@ -0,0 +1,168 @@
+#include "hist.h"
+
+/* percentiles in the exports */
+static const double hist_points[] = {50.0, 90.0, 99.0, 99.9};
+
+/**
+ * @brief Bucket of a value.
+ *
+ * @param value Non-negative Value
+ * @return int
+ */
+int hist_index(long value) {
+  unsigned long v = (unsigned long)value;
+  int msb = 0;
+
+  if (v < HIST_SUB)
+    return (int)v;
+  for (int step = 32; step > 0; step /= 2) {
+    if (v >> (msb + step))
+      msb += step;
+  }
+  int shift = msb - HIST_SUB_BITS;
+  return (shift + 1) * HIST_SUB + (int)(v >> shift) - HIST_SUB;
+}
+
+/**
+ * @brief Smallest value of a bucket.
+ *
+ * @param index Bucket
+ * @return long
+ */
+long hist_low(int index) {
+  if (index < HIST_SUB)
+    return index;
+  return (long)(index % HIST_SUB + HIST_SUB) << (index / HIST_SUB - 1);
+}
+
+/**
+ * @brief Largest value of a bucket.
+ *
+ * @param index Bucket
+ * @return long
+ */
+long hist_high(int index) {
+  if (index < HIST_SUB)
+    return index;
+  return hist_low(index) + (1L << (index / HIST_SUB - 1)) - 1;
+}
+
+/**
+ * @brief Count a value.
+ *
+ * @param hist Target Histogram
+ * @param value Non-negative Value, negative values count as 0
+ */
+void hist_record(Histogram *hist, long value) {
+  if (value < 0)
+    value = 0;
+  if (hist->count == 0 || value < hist->min)
+    hist->min = value;
+  if (hist->count == 0 || value > hist->max)
+    hist->max = value;
+  hist->count++;
+  hist->sum += (double)value;
+  hist->buckets[hist_index(value)]++;
+}
+
+/**
+ * @brief Add the values of one histogram to another.
+ *
+ * @param total Target Histogram
+ * @param part Source Histogram
+ */
+void hist_merge(Histogram *total, const Histogram *part) {
+  if (part->count == 0)
+    return;
+  if (total->count == 0 || part->min < total->min)
+    total->min = part->min;
+  if (total->count == 0 || part->max > total->max)
+    total->max = part->max;
+  total->count += part->count;
+  total->sum += part->sum;
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    total->buckets[i] += part->buckets[i];
+  }
+}
+
+/**
+ * @brief Value below or at which a share of the values lies.
+ *
+ * Reports the largest value of the bucket, so the result is at most 1/16 too high.
+ *
+ * @param hist Source Histogram
+ * @param percent Share in percent, 0-100
+ * @return long 0 for empty histograms
+ */
+long hist_percentile(const Histogram *hist, double percent) {
+  double share = percent / 100.0 * (double)hist->count;
+  long rank = (long)share, seen = 0;
+
+  if (hist->count == 0)
+    return 0;
+  if ((double)rank < share || rank < 1)
+    rank++;
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    seen += hist->buckets[i];
+    if (seen >= rank) {
+      long high = hist_high(i);
+      return high > hist->max ? hist->max : high < hist->min ? hist->min : high;
+    }
+  }
+  return hist->max;
+}
+
+/**
+ * @brief Average of all values.
+ *
+ * @param hist Source Histogram
+ * @return double
+ */
+double hist_mean(const Histogram *hist) {
+  return hist->count ? hist->sum / (double)hist->count : 0.0;
+}
+
+/**
+ * @brief Write the summary of a histogram as one CSV row.
+ *
+ * Columns: name, count, min, mean, p50, p90, p99, p99.9, max.
+ *
+ * @param fw Target File
+ * @param name Metric Name
+ * @param hist Source Histogram
+ */
+void hist_csv(FILE *fw, const char *name, const Histogram *hist) {
+  fprintf(fw, "%s,%ld,%ld,%.2f", name, hist->count, hist->count ? hist->min : 0, hist_mean(hist));
+  for (size_t i = 0; i < sizeof(hist_points) / sizeof(hist_points[0]); i++) {
+    fprintf(fw, ",%ld", hist_percentile(hist, hist_points[i]));
+  }
+  fprintf(fw, ",%ld\n", hist->count ? hist->max : 0);
+}
+
+/**
+ * @brief Write a histogram as a JSON member.
+ *
+ * Holds the summary like @c hist_csv() and the non-empty buckets as
+ * [low, high, count] triples.
+ *
+ * @param fw Target File
+ * @param name Metric Name
+ * @param hist Source Histogram
+ */
+void hist_json(FILE *fw, const char *name, const Histogram *hist) {
+  const char *sep = "";
+
+  fprintf(fw, "\"%s\": {\"count\": %ld, \"min\": %ld, \"mean\": %.2f", name, hist->count,
+          hist->count ? hist->min : 0, hist_mean(hist));
+  for (size_t i = 0; i < sizeof(hist_points) / sizeof(hist_points[0]); i++) {
+    fprintf(fw, ", \"p%g\": %ld", hist_points[i], hist_percentile(hist, hist_points[i]));
+  }
+  fprintf(fw, ", \"max\": %ld, \"buckets\": [", hist->count ? hist->max : 0);
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    if (hist->buckets[i] == 0)
+      continue;
+    fprintf(fw, "%s[%ld, %ld, %ld]", sep, hist_low(i), hist_high(i), hist->buckets[i]);
+    sep = ", ";
+  }
+  fprintf(fw, "]}");
+}
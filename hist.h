@@ -0,0 +1,34 @@
+#ifndef BATTLESHIPS_HIST_H
+#define BATTLESHIPS_HIST_H
+
+#include <stdio.h>
+
+/* linear buckets per power of two: exact below 16, within 1/16 of the value above */
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS) * HIST_SUB)
+
+/*
+ * Log-linear histogram of non-negative values (HDR style). Fixed size, recording never
+ * allocates or locks. Every thread or process records into its own histograms, they
+ * are merged by adding up the buckets.
+ */
+typedef struct histogram {
+  long count;
+  long min;
+  long max;
+  double sum;
+  long buckets[HIST_BUCKETS];
+} Histogram;
+
+int hist_index(long value);
+long hist_low(int index);
+long hist_high(int index);
+void hist_record(Histogram *hist, long value);
+void hist_merge(Histogram *total, const Histogram *part);
+long hist_percentile(const Histogram *hist, double percent);
+double hist_mean(const Histogram *hist);
+void hist_csv(FILE *fw, const char *name, const Histogram *hist);
+void hist_json(FILE *fw, const char *name, const Histogram *hist);
+
+#endif //BATTLESHIPS_HIST_H
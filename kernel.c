@@ -0,0 +1,315 @@
+#include "kernel.h"
+#include "config.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* bits of a ship of length n plus one field on each side, for n up to KERNEL_RANGE */
+static const uint16_t halo_line[KERNEL_RANGE + 1] = {
+    0x0003, 0x0007, 0x000f, 0x001f, 0x003f, 0x007f, 0x00ff,
+    0x01ff, 0x03ff, 0x07ff, 0x0fff, 0x1fff, 0x3fff, 0x7fff,
+};
+
+/* hit type by symbol + 1 like checkShot(): MISS, WATER, HIT, ships of length 2-5 */
+static const int shot_table[7] = {0, -1, 0, 1, 1, 1, 1};
+
+/**
+ * @brief Generic placement check, see @c isvalid().
+ */
+static bool generic_valid(const Board *game_board, Coordinate position, int direction, int size, int index) {
+  return isvalid(game_board, position, game_board->game_range, direction, size, index);
+}
+
+/**
+ * @brief Generic hit type, see @c checkShot().
+ */
+static int generic_shot(const Board *game_board, Coordinate target) {
+  return checkShot(game_board, target);
+}
+
+const Kernel kernel_generic = {0, generic_valid, generic_shot};
+
+/*
+ * Kernels for a fixed board dimension N.
+ *
+ * The placement check reads the three occupancy lines along the ship (rows for
+ * horizontal, columns for vertical ships) and tests them against the constant halo
+ * mask, so it has no loops and no bounds checks besides the ship fitting the board.
+ * Any non water field blocks: the ship being placed is never on the board yet.
+ *
+ * The shot check indexes the contiguous cell block with a constant stride.
+ */
+#define KERNEL_DEFINE(N)                                                                                            \
+  static bool kernel_valid_##N(const Board *game_board, Coordinate position, int direction, int size, int index) {  \
+    int along = direction == 0 ? position.col : position.row;                                                       \
+    const uint16_t *lines = game_board->occupancy[direction != 0] + (direction == 0 ? position.row : position.col); \
+                                                                                                                    \
+    if (along + size > (N))                                                                                         \
+      return false;                                                                                                 \
+    return ((lines[0] | lines[1] | lines[2]) & (halo_line[size] << along)) == 0;                                    \
+  }                                                                                                                 \
+                                                                                                                    \
+  static int kernel_shot_##N(const Board *game_board, Coordinate target) {                                         \
+    return shot_table[game_board->cells[0][target.row * (N) + target.col].symbol + 1];                             \
+  }                                                                                                                 \
+                                                                                                                    \
+  static const Kernel kernel_##N = {(N), kernel_valid_##N, kernel_shot_##N};
+
+KERNEL_DEFINE(5)
+KERNEL_DEFINE(7)
+KERNEL_DEFINE(10)
+KERNEL_DEFINE(13)
+
+static const Kernel *kernels[] = {&kernel_5, &kernel_7, &kernel_10, &kernel_13};
+
+/**
+ * @brief Picks the kernel for a board.
+ *
+ * @param game_range Target Board Dimension
+ * @param sparse Board uses the sparse storage
+ * @return const Kernel* a specialised kernel for the built-in sizes, the generic one otherwise
+ */
+const Kernel *kernel_select(int game_range, bool sparse) {
+  if (sparse || game_range > KERNEL_RANGE)
+    return &kernel_generic;
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    if (kernels[k]->game_range == game_range)
+      return kernels[k];
+  }
+  return &kernel_generic;
+}
+
+#if defined(__AVX2__)
+/**
+ * @brief Valid anchors of all lines at once, one line per 16 bit lane.
+ *
+ * @param lines Occupancy lines with padding, 32 entries
+ * @param size Ship Length
+ * @param fit Anchors that keep the ship on the board, shifted by the padding bit
+ * @param out Anchor bits of 16 lines
+ */
+static void anchors_lines(const uint16_t *lines, int size, uint16_t fit, uint16_t *out) {
+  __m256i d = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)lines),
+                              _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(lines + 1)),
+                                              _mm256_loadu_si256((const __m256i *)(lines + 2))));
+  __m256i blocked = _mm256_or_si256(d, _mm256_or_si256(_mm256_slli_epi16(d, 1), _mm256_srli_epi16(d, 1)));
+  __m256i clear = _mm256_andnot_si256(blocked, _mm256_set1_epi16(-1));
+  __m256i a = _mm256_and_si256(clear, _mm256_set1_epi16((short)fit));
+
+  for (int i = 1; i < size; i++) {
+    a = _mm256_and_si256(a, _mm256_srl_epi16(clear, _mm_cvtsi32_si128(i)));
+  }
+  _mm256_storeu_si256((__m256i *)out, _mm256_srli_epi16(a, 1));
+}
+#else
+/**
+ * @brief Valid anchors of all lines, one line after the other.
+ *
+ * @param lines Occupancy lines with padding, 32 entries
+ * @param size Ship Length
+ * @param fit Anchors that keep the ship on the board, shifted by the padding bit
+ * @param out Anchor bits of 16 lines
+ */
+static void anchors_lines(const uint16_t *lines, int size, uint16_t fit, uint16_t *out) {
+  for (int r = 0; r < 16; r++) {
+    uint16_t d = lines[r] | lines[r + 1] | lines[r + 2];
+    uint16_t clear = (uint16_t)~(d | d << 1 | d >> 1);
+    uint16_t a = clear & fit;
+    for (int i = 1; i < size; i++) {
+      a &= clear >> i;
+    }
+    out[r] = a >> 1;
+  }
+}
+#endif
+
+/**
+ * @brief Number of set bits.
+ *
+ * @param v Bits
+ * @return int
+ */
+static int bit_count(uint16_t v) {
+  int n = 0;
+  for (; v != 0; n++) {
+    v &= v - 1;
+  }
+  return n;
+}
+
+/**
+ * @brief Map every valid position of a ship in one pass.
+ *
+ * Dilates the occupancy lines by the halo and looks for free runs of the ship length,
+ * 16 lines at a time with AVX2 or line by line otherwise. Gives the same positions as
+ * the placement check of the kernel for every field and direction.
+ *
+ * @param game_board Source Board
+ * @param size Ship Length
+ * @param anchors Bit c of line r set if the ship fits at row r, column c horizontally
+ *                (anchors[0]) or at column r, row c vertically (anchors[1])
+ * @return int number of valid positions, -1 if the board has no occupancy lines
+ */
+int kernel_anchors(const Board *game_board, int size, uint16_t anchors[2][KERNEL_RANGE]) {
+  int n = game_board->game_range, found = 0;
+  uint16_t lines[32] = {0}, out[16];
+
+  if (game_board->cells == NULL || n > KERNEL_RANGE)
+    return -1;
+  if (size > n) {
+    memset(anchors, 0, 2 * KERNEL_RANGE * sizeof(uint16_t));
+    return 0;
+  }
+  uint16_t fit = (uint16_t)(((1u << (n - size + 1)) - 1) << 1);
+  for (int d = 0; d < 2; d++) {
+    memcpy(lines, game_board->occupancy[d], (n + 2) * sizeof(uint16_t));
+    anchors_lines(lines, size, fit, out);
+    for (int r = 0; r < n; r++) {
+      anchors[d][r] = out[r];
+      found += bit_count(out[r]);
+    }
+  }
+  return found;
+}
+
+/**
+ * @brief Time the placement and shot checks of one kernel on a board.
+ *
+ * Checks every field in both directions for every ship length, then every field as
+ * a shot target.
+ *
+ * @param kernel Kernel to time
+ * @param game_board Board with a fleet on it
+ * @param rounds Repetitions
+ * @param ns Nanoseconds per placement and per shot check
+ * @return long checksum of all results, equal for equal kernels
+ */
+static long bench_kernel(const Kernel *kernel, const Board *game_board, int rounds, double ns[2]) {
+  int n = game_board->game_range;
+  long sum = 0, valid = 0, shots = 0;
+  Coordinate pos;
+
+  clock_t begin = clock();
+  for (int r = 0; r < rounds; r++) {
+    for (pos.row = 0; pos.row < n; pos.row++) {
+      for (pos.col = 0; pos.col < n; pos.col++) {
+        for (int size = 2; size <= 5 && size <= n; size++) {
+          sum += kernel->valid(game_board, pos, 0, size, -1) + 2 * kernel->valid(game_board, pos, 1, size, -1);
+          valid += 2;
+        }
+      }
+    }
+  }
+  clock_t middle = clock();
+  for (int r = 0; r < rounds; r++) {
+    for (pos.row = 0; pos.row < n; pos.row++) {
+      for (pos.col = 0; pos.col < n; pos.col++) {
+        sum += kernel->shot(game_board, pos) + 1;
+        shots++;
+      }
+    }
+  }
+  clock_t end = clock();
+  ns[0] = (double)(middle - begin) / CLOCKS_PER_SEC * 1e9 / valid;
+  ns[1] = (double)(end - middle) / CLOCKS_PER_SEC * 1e9 / shots;
+  return sum;
+}
+
+/**
+ * @brief Time the anchor map against checking every position with the kernel.
+ *
+ * @param game_board Board with a fleet on it
+ * @param rounds Repetitions
+ * @param ns Nanoseconds per map and per scan of all positions, every ship length
+ * @return int 0 if both find the same positions, -1 otherwise
+ */
+static int bench_anchors(const Board *game_board, int rounds, double ns[2]) {
+  int n = game_board->game_range, ret = 0;
+  uint16_t anchors[2][KERNEL_RANGE];
+  long mapped = 0, scanned = 0;
+  Coordinate pos;
+
+  clock_t begin = clock();
+  for (int r = 0; r < rounds; r++) {
+    for (int size = 2; size <= 5 && size <= n; size++) {
+      mapped += kernel_anchors(game_board, size, anchors);
+    }
+  }
+  clock_t middle = clock();
+  for (int r = 0; r < rounds; r++) {
+    for (int size = 2; size <= 5 && size <= n; size++) {
+      for (pos.row = 0; pos.row < n; pos.row++) {
+        for (pos.col = 0; pos.col < n; pos.col++) {
+          scanned += game_board->kernel->valid(game_board, pos, 0, size, -1) +
+                     game_board->kernel->valid(game_board, pos, 1, size, -1);
+        }
+      }
+    }
+  }
+  clock_t end = clock();
+  ns[0] = (double)(middle - begin) / CLOCKS_PER_SEC * 1e9 / rounds;
+  ns[1] = (double)(end - middle) / CLOCKS_PER_SEC * 1e9 / rounds;
+
+  for (int size = 2; size <= 5 && size <= n; size++) {
+    kernel_anchors(game_board, size, anchors);
+    for (pos.row = 0; pos.row < n; pos.row++) {
+      for (pos.col = 0; pos.col < n; pos.col++) {
+        if (((anchors[0][pos.row] >> pos.col) & 1) != game_board->kernel->valid(game_board, pos, 0, size, -1) ||
+            ((anchors[1][pos.col] >> pos.row) & 1) != game_board->kernel->valid(game_board, pos, 1, size, -1))
+          ret = -1;
+      }
+    }
+  }
+  return mapped == scanned ? ret : -1;
+}
+
+/**
+ * @brief Compare the specialised kernels with the generic one.
+ *
+ * Places the fleet of every built-in mode and prints the time per check of both
+ * kernels and the speedup, then times the anchor map against scanning every position.
+ *
+ * @param rounds Repetitions per mode
+ * @return int 0 on success, -1 on errors or when the kernels disagree
+ */
+int kernel_bench(int rounds) {
+  // hidden from the optimiser, calls go through the pointer like in a game
+  const Kernel *volatile generic = &kernel_generic;
+  Config config = {0};
+  Board board;
+  int ret = 0;
+
+  srand(1);
+  for (int mode = 1; mode <= GAME_MODES && ret == 0; mode++) {
+    double ns_generic[2], ns_kernel[2];
+
+    if (config_mode(&config, mode) != 0 || board_alloc(&board, config.game_range, false) != 0) {
+      ret = -1;
+      break;
+    }
+    if (board_rand(&board, ship_type_default, config.game_range, config.ship_mode, config.ship_total, 0) != 0) {
+      board_free(&board);
+      ret = -1;
+      break;
+    }
+    long expect = bench_kernel(generic, &board, rounds, ns_generic);
+    long got = bench_kernel(board.kernel, &board, rounds, ns_kernel);
+    if (expect != got) {
+      fprintf(stderr, "mode %d: kernel results differ\n", mode);
+      ret = -1;
+    }
+    printf("mode %d (%dx%d): valid %.2f ns generic, %.2f ns kernel, %.1fx; shot %.2f ns generic, %.2f ns kernel, %.1fx\n",
+           mode, config.game_range, config.game_range, ns_generic[0], ns_kernel[0], ns_generic[0] / ns_kernel[0],
+           ns_generic[1], ns_kernel[1], ns_generic[1] / ns_kernel[1]);
+    if (bench_anchors(&board, rounds, ns_kernel) != 0) {
+      fprintf(stderr, "mode %d: anchor map differs from the kernel\n", mode);
+      ret = -1;
+    }
+    printf("mode %d: all positions of lengths 2-5 %.1f ns anchor map, %.1f ns kernel scan, %.1fx\n", mode,
+           ns_kernel[0], ns_kernel[1], ns_kernel[1] / ns_kernel[0]);
+    board_free(&board);
+  }
+  config_free(&config);
+  return ret;
+}
@@ -0,0 +1,24 @@
+#include "battleship.h"
+
+#ifndef BATTLESHIPS_KERNEL_H
+#define BATTLESHIPS_KERNEL_H
+
+/*
+ * Placement and shot checks of a board, picked once when the board is allocated.
+ * The built-in board sizes get kernels compiled for their exact dimension, all other
+ * boards use the generic @c isvalid() and @c checkShot().
+ */
+typedef struct kernel {
+  /* board dimension the kernel is compiled for, 0 for the generic kernel */
+  int game_range;
+  bool (*valid)(const Board *game_board, Coordinate position, int direction, int size, int index);
+  int (*shot)(const Board *game_board, Coordinate target);
+} Kernel;
+
+extern const Kernel kernel_generic;
+
+const Kernel *kernel_select(int game_range, bool sparse);
+int kernel_anchors(const Board *game_board, int size, uint16_t anchors[2][KERNEL_RANGE]);
+int kernel_bench(int rounds);
+
+#endif //BATTLESHIPS_KERNEL_H
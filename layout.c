@@ -0,0 +1,629 @@
+#include "layout.h"
+#include "config.h"
+#include "arrange.h"
+#include "kernel.h"
+
+/*
+ * Exact search for one layout. Every ship claims its cells plus the row below and the
+ * column to the right of it on a board widened by one row and column. Two ships keep
+ * apart exactly when these footprints don't overlap, so the footprints of a fleet
+ * take 2 * (length + 1) cells each and never share one.
+ */
+typedef struct search {
+  int n;
+  int kinds;
+  /* distinct ship lengths, longest first, and how many are left to place */
+  int length[LAYOUT_SEARCH_RANGE + 1];
+  int left[LAYOUT_SEARCH_RANGE + 1];
+  /* footprints per row of the widened board */
+  uint64_t rows[LAYOUT_SEARCH_RANGE + 1];
+  long nodes;
+  long budget;
+  bool shuffle;
+  /* placements so far and their lengths */
+  uint32_t *placed;
+  int *placed_length;
+  int depth;
+} Search;
+
+static int search_cell(Search *s, int r, int c, long free_cells, long need);
+
+/**
+ * @brief Bits @c from to @c from + @c count - 1 of a row.
+ *
+ * @param from First Bit
+ * @param count Number of Bits, at most 64
+ * @return uint64_t
+ */
+static uint64_t row_mask(int from, int count) {
+  return (count == 64 ? ~(uint64_t)0 : (((uint64_t)1 << count) - 1)) << from;
+}
+
+/**
+ * @brief Move the search to the next cell of the board.
+ *
+ * The halo cell at the end of a row is passed on the way, a free one can't be claimed
+ * by a later footprint anymore.
+ *
+ * @param s Search State
+ * @param r Row
+ * @param c Column
+ * @param free_cells Unclaimed cells of the widened board from (r, c) on
+ * @param need Footprint cells of the ships left
+ * @return int 1 when a layout is found, 0 if there is none, -1 when out of nodes
+ */
+static int search_next(Search *s, int r, int c, long free_cells, long need) {
+  if (++c == s->n) {
+    if (!(s->rows[r] >> s->n & 1))
+      free_cells--;
+    r++;
+    c = 0;
+  }
+  return search_cell(s, r, c, free_cells, need);
+}
+
+/**
+ * @brief Try every ship that can start at a cell, or none.
+ *
+ * Ships are anchored in row major order, so a cell that is passed stays water and
+ * the free cells ahead bound the ships that still fit.
+ *
+ * @param s Search State
+ * @param r Row
+ * @param c Column
+ * @param free_cells Unclaimed cells of the widened board from (r, c) on
+ * @param need Footprint cells of the ships left
+ * @return int 1 when a layout is found, 0 if there is none, -1 when out of nodes
+ */
+static int search_cell(Search *s, int r, int c, long free_cells, long need) {
+  int options[2 * (LAYOUT_SEARCH_RANGE + 1) + 1], count = 0, ret;
+
+  if (need == 0)
+    return 1;
+  // cells claimed by a footprint are passed without a choice
+  while (r < s->n && (s->rows[r] >> c & 1)) {
+    if (++c == s->n) {
+      if (!(s->rows[r] >> s->n & 1))
+        free_cells--;
+      r++;
+      c = 0;
+    }
+  }
+  if (r >= s->n || free_cells < need)
+    return 0;
+  if (++s->nodes > s->budget)
+    return -1;
+
+  for (int k = 0; k < s->kinds; k++) {
+    int len = s->length[k];
+    if (s->left[k] == 0)
+      continue;
+    uint64_t across = row_mask(c, len + 1), down = row_mask(c, 2);
+    if (c + len <= s->n && !(s->rows[r] & across) && !(s->rows[r + 1] & across))
+      options[count++] = 2 * k;
+    if (len > 1 && r + len <= s->n) {
+      int d = r;
+      while (d <= r + len && !(s->rows[d] & down))
+        d++;
+      if (d > r + len)
+        options[count++] = 2 * k + 1;
+    }
+  }
+  if (s->shuffle) {
+    for (int i = count - 1; i > 0; i--) {
+      int j = inRange(0, i), tmp = options[i];
+      options[i] = options[j];
+      options[j] = tmp;
+    }
+  }
+  // leaving the cell as water comes last
+  options[count++] = -1;
+
+  for (int i = 0; i < count; i++) {
+    if (options[i] < 0) {
+      ret = search_next(s, r, c, free_cells - 1, need);
+    } else {
+      int k = options[i] / 2, dir = options[i] % 2, len = s->length[k];
+      int rows = dir == 0 ? 1 : len, cols = dir == 0 ? len : 1;
+      uint64_t mask = row_mask(c, cols + 1);
+      for (int d = r; d <= r + rows; d++) {
+        s->rows[d] |= mask;
+      }
+      s->left[k]--;
+      s->placed[s->depth] = (uint32_t)r << 16 | (uint32_t)c << 1 | (uint32_t)dir;
+      s->placed_length[s->depth++] = len;
+      ret = search_next(s, r, c, free_cells - 2 * (len + 1), need - 2 * (len + 1));
+      if (ret == 1)
+        return 1;
+      s->depth--;
+      s->left[k]++;
+      for (int d = r; d <= r + rows; d++) {
+        s->rows[d] &= ~mask;
+      }
+    }
+    if (ret != 0)
+      return ret;
+  }
+  return 0;
+}
+
+/**
+ * @brief Search for a layout of the fleet cell by cell.
+ *
+ * @param config Board Size and Fleet, at most @c LAYOUT_SEARCH_RANGE
+ * @param shuffle Try the ships that fit at every cell in random order
+ * @param budget Nodes to visit at most
+ * @param found Layout in fleet order, see @c Layouts
+ * @return int 1 when a layout is found, 0 if there is none, -1 when out of nodes or memory
+ */
+static int layout_search(const Config *config, bool shuffle, long budget, uint32_t *found) {
+  Search s = {0};
+  int n = config->game_range, total = config->ship_total, ret;
+  long need = 0;
+
+  s.n = n;
+  s.shuffle = shuffle;
+  s.budget = budget;
+  for (int len = n; len >= 1; len--) {
+    for (int j = 0; j < total; j++) {
+      if (config->ship_mode[j] == len)
+        s.left[s.kinds]++;
+    }
+    if (s.left[s.kinds] > 0) {
+      s.length[s.kinds++] = len;
+      need += 2L * (len + 1) * s.left[s.kinds - 1];
+    }
+  }
+  s.placed = malloc(total * (sizeof(uint32_t) + sizeof(int)));
+  if (s.placed == NULL)
+    return -1;
+  s.placed_length = (int *)(s.placed + total);
+
+  ret = search_cell(&s, 0, 0, (long)(n + 1) * (n + 1), need);
+  if (ret == 1) {
+    // hand out the placements to the ships of the same length in fleet order
+    for (int j = 0; j < total; j++) {
+      for (int i = 0; i < s.depth; i++) {
+        if (s.placed_length[i] == config->ship_mode[j]) {
+          found[j] = s.placed[i];
+          s.placed_length[i] = 0;
+          break;
+        }
+      }
+    }
+  }
+  free(s.placed);
+  return ret;
+}
+
+/**
+ * @brief Compare two ship lengths, longest first.
+ */
+static int length_desc(const void *a, const void *b) {
+  int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+  return (x < y) - (x > y);
+}
+
+/**
+ * @brief Pack the fleet into every other row, longest ships first.
+ *
+ * Ships in a row keep one field apart, rows in between stay water. Finds a layout for
+ * most fleets that leave some room quickly, on boards of any size.
+ *
+ * @param config Board Size and Fleet
+ * @param found Layout in fleet order, see @c Layouts
+ * @return int 0 when a layout is found, -1 otherwise
+ */
+static int layout_shelves(const Config *config, uint32_t *found) {
+  int n = config->game_range, total = config->ship_total, shelves = (n + 1) / 2, ret = 0;
+  // length and fleet index in one key
+  int64_t *order = malloc(total * sizeof(int64_t));
+  int *used = calloc(shelves, sizeof(int));
+
+  if (order == NULL || used == NULL) {
+    free(order);
+    free(used);
+    return -1;
+  }
+  for (int j = 0; j < total; j++) {
+    order[j] = (int64_t)config->ship_mode[j] << 32 | j;
+  }
+  qsort(order, total, sizeof(int64_t), length_desc);
+  for (int i = 0; i < total && ret == 0; i++) {
+    int j = (int)(order[i] & 0xffffffff), len = config->ship_mode[j], shelf = 0;
+    while (shelf < shelves && used[shelf] + (used[shelf] > 0) + len > n)
+      shelf++;
+    if (shelf == shelves) {
+      ret = -1;
+      break;
+    }
+    int col = used[shelf] + (used[shelf] > 0);
+    found[j] = (uint32_t)(2 * shelf) << 16 | (uint32_t)col << 1;
+    used[shelf] = col + len;
+  }
+  free(order);
+  free(used);
+  return ret;
+}
+
+/**
+ * @brief Footprint cells of a fleet, its cells plus the halo on one side and below.
+ *
+ * @param config Board Size and Fleet
+ * @return long Cells out of the (n + 1) x (n + 1) board the fleet covers
+ */
+static long layout_footprint(const Config *config) {
+  long need = 0;
+
+  for (int j = 0; j < config->ship_total; j++) {
+    need += 2L * (config->ship_mode[j] + 1);
+  }
+  return need;
+}
+
+/**
+ * @brief Checks if random placement lays out a fleet without help.
+ *
+ * @param config Board Size and Fleet
+ * @return true if the footprint covers less than 1 / @c LAYOUT_SPARSE of the board
+ * @return false
+ */
+static bool layout_sparse(const Config *config) {
+  long side = config->game_range + 1;
+
+  return layout_footprint(config) * LAYOUT_SPARSE < side * side;
+}
+
+/**
+ * @brief Decide whether a fleet fits and find a layout on the way.
+ *
+ * @param config Board Size and Fleet
+ * @param found Layout in fleet order, see @c Layouts
+ * @param laid_out Set when @c found holds a layout
+ * @return int LAYOUT_FEASIBLE, LAYOUT_INFEASIBLE or LAYOUT_UNKNOWN
+ */
+static int layout_decide(const Config *config, uint32_t *found, bool *laid_out) {
+  int n = config->game_range;
+  uint64_t count;
+  ArrangeStats stats;
+
+  *laid_out = false;
+  for (int j = 0; j < config->ship_total; j++) {
+    if (config->ship_mode[j] > n)
+      return LAYOUT_INFEASIBLE;
+  }
+  if (layout_footprint(config) > (long)(n + 1) * (n + 1))
+    return LAYOUT_INFEASIBLE;
+  if (layout_shelves(config, found) == 0) {
+    *laid_out = true;
+    return LAYOUT_FEASIBLE;
+  }
+  if (n <= LAYOUT_SEARCH_RANGE) {
+    int ret = layout_search(config, false, LAYOUT_NODES, found);
+    *laid_out = ret == 1;
+    if (ret >= 0)
+      return ret == 1 ? LAYOUT_FEASIBLE : LAYOUT_INFEASIBLE;
+  }
+  // the search gave up, counting settles small boards
+  if (n <= LAYOUT_COUNT_RANGE && arrange_dp(config, &count, &stats) == 0)
+    return count > 0 ? LAYOUT_FEASIBLE : LAYOUT_INFEASIBLE;
+  return LAYOUT_UNKNOWN;
+}
+
+/**
+ * @brief Decide whether a fleet fits the board under the no-touch rule.
+ *
+ * Area bounds first: every ship needs its cells plus the halo on one side and
+ * below, see @c Search. Packing the ships into rows proves most fleets fit, the
+ * exact search settles the rest on boards up to @c LAYOUT_SEARCH_RANGE. Fleets
+ * the search gives up on are counted, see @c arrange_dp(), on boards up to
+ * @c LAYOUT_COUNT_RANGE.
+ *
+ * @param config Board Size and Fleet
+ * @param found Set to a layout when one was found on the way, see @c Layouts, may be NULL
+ * @return int LAYOUT_FEASIBLE, LAYOUT_INFEASIBLE or LAYOUT_UNKNOWN when undecided
+ */
+int layout_check(const Config *config, uint32_t *found) {
+  uint32_t *layout = found != NULL ? found : malloc(config->ship_total * sizeof(uint32_t));
+  bool laid_out;
+
+  if (layout == NULL)
+    return LAYOUT_UNKNOWN;
+  int ret = layout_decide(config, layout, &laid_out);
+  if (found == NULL)
+    free(layout);
+  return ret;
+}
+
+/**
+ * @brief Fill the layout pool of a configuration.
+ *
+ * Layouts come from random placement like in a game. Fleets too crowded for random
+ * placement are laid out by the exact search with the ships in random order instead,
+ * each search gets a share of the node budget. Seeded with
+ * the configuration hash, so every process builds the same pool.
+ *
+ * @param layouts Target Layouts, room for @c LAYOUT_POOL layouts
+ * @param config Board Size and Fleet
+ * @return int 0 on success, -1 when out of memory
+ */
+static int layout_generate(Layouts *layouts, const Config *config) {
+  int n = config->game_range, total = config->ship_total;
+  bool random = true;
+  Board board;
+
+  if (board_alloc(&board, n, false) != 0)
+    return -1;
+  if ((board.ships = malloc(total * sizeof(Ship))) == NULL) {
+    board_free(&board);
+    return -1;
+  }
+  srand(layouts->hash);
+  while (layouts->count < LAYOUT_POOL) {
+    uint32_t *layout = layouts->ships + (size_t)layouts->count * total;
+    if (random) {
+      board_clear(&board, n);
+      if (board_rand(&board, ship_type_default, n, config->ship_mode, total, 0) == 0) {
+        for (int j = 0; j < total; j++) {
+          layout[j] = (uint32_t)board.ships[j].position.row << 16 | (uint32_t)board.ships[j].position.col << 1 |
+                      (uint32_t)board.ships[j].direction;
+        }
+        layouts->count++;
+        continue;
+      }
+      random = false;
+    }
+    if (n > LAYOUT_SEARCH_RANGE || layout_search(config, true, LAYOUT_NODES / LAYOUT_POOL, layout) != 1)
+      break;
+    layouts->count++;
+  }
+  free(board.ships);
+  board.ships = NULL;
+  board_free(&board);
+  return 0;
+}
+
+/**
+ * @brief Checks that every layout places the fleet by the rules.
+ *
+ * The checksum of the cache file only catches accidental damage. Each layout is
+ * placed on a scratch board, a ship outside the board or touching another one
+ * rejects the whole pool.
+ *
+ * @param layouts Source Layouts
+ * @param config Board Size and Fleet
+ * @return int 0 if all layouts are valid, -1 if not or out of memory
+ */
+static int layout_verify(const Layouts *layouts, const Config *config) {
+  int n = config->game_range, total = config->ship_total, ret = 0;
+  Board board;
+
+  if (layouts->count == 0)
+    return 0;
+  if (board_alloc(&board, n, false) != 0)
+    return -1;
+  for (int i = 0; ret == 0 && i < layouts->count; i++) {
+    const uint32_t *layout = layouts->ships + (size_t)i * total;
+    board_clear(&board, n);
+    for (int j = 0; ret == 0 && j < total; j++) {
+      int len = config->ship_mode[j], dir = (int)(layout[j] & 1);
+      Coordinate pos = {(int)(layout[j] >> 16), (int)(layout[j] >> 1 & 0x7fff)};
+      if (pos.row + (dir == 1 ? len : 1) > n || pos.col + (dir == 0 ? len : 1) > n ||
+          !board.kernel->valid(&board, pos, dir, len, j) ||
+          board_fill(&board, ship_type_default, pos, len, dir, j) != 0)
+        ret = -1;
+    }
+  }
+  board_free(&board);
+  return ret;
+}
+
+/**
+ * @brief Read the layouts of a configuration from its cache file.
+ *
+ * Files with an undecided verdict, written before those were left out, are ignored.
+ *
+ * @param layouts Target Layouts, hash set
+ * @param config Board Size and Fleet, must match the file
+ * @param path Cache File
+ * @return int 0 on success, -1 if the file is missing, damaged, for another fleet or
+ *             holds an invalid layout
+ */
+static int layout_load(Layouts *layouts, const Config *config, const char *path) {
+  uint32_t header[4];
+  int32_t body[5];
+  FILE *fr = fopen(path, "rb");
+  int32_t *modes = NULL;
+  int ret = -1;
+
+  if (fr == NULL)
+    return -1;
+  if (fread(header, sizeof(header), 1, fr) != 1 || fread(body, sizeof(body), 1, fr) != 1 ||
+      header[0] != LAYOUT_MAGIC || header[1] != LAYOUT_VERSION || (uint32_t)body[0] != layouts->hash ||
+      body[1] != config->game_range || body[2] != config->ship_total || body[3] < LAYOUT_INFEASIBLE ||
+      body[3] > LAYOUT_FEASIBLE || body[4] < 0 || body[4] > LAYOUT_POOL ||
+      header[2] != sizeof(header) + sizeof(body) + (size_t)config->ship_total * (1 + body[4]) * sizeof(int32_t)) {
+    fclose(fr);
+    return -1;
+  }
+  size_t count = (size_t)body[4] * config->ship_total;
+  modes = malloc(config->ship_total * sizeof(int32_t));
+  layouts->ships = malloc((size_t)LAYOUT_POOL * config->ship_total * sizeof(uint32_t));
+  if (modes != NULL && layouts->ships != NULL &&
+      fread(modes, sizeof(int32_t), config->ship_total, fr) == (size_t)config->ship_total &&
+      fread(layouts->ships, sizeof(uint32_t), count, fr) == count) {
+    uint32_t sum = fnv1a(FNV_BASIS, body, sizeof(body));
+    sum = fnv1a(sum, modes, config->ship_total * sizeof(int32_t));
+    sum = fnv1a(sum, layouts->ships, count * sizeof(uint32_t));
+    ret = sum == header[3] ? 0 : -1;
+    for (int j = 0; ret == 0 && j < config->ship_total; j++) {
+      if (modes[j] != config->ship_mode[j])
+        ret = -1;
+    }
+    layouts->count = body[4];
+    if (ret == 0)
+      ret = layout_verify(layouts, config);
+  }
+  free(modes);
+  fclose(fr);
+  if (ret != 0) {
+    free(layouts->ships);
+    layouts->ships = NULL;
+    layouts->count = 0;
+    return -1;
+  }
+  layouts->verdict = body[3];
+  layouts->loaded = true;
+  return 0;
+}
+
+/**
+ * @brief Write the layouts of a configuration into its cache file.
+ *
+ * Written next to @c path first and renamed, like snapshots.
+ *
+ * @param layouts Source Layouts
+ * @param config Board Size and Fleet
+ * @param path Cache File
+ * @return int 0 on success, -1 on IO errors
+ */
+static int layout_save(const Layouts *layouts, const Config *config, const char *path) {
+  int32_t body[5] = {(int32_t)layouts->hash, layouts->game_range, layouts->ship_total, layouts->verdict,
+                     layouts->count};
+  size_t count = (size_t)layouts->count * layouts->ship_total, modes = layouts->ship_total * sizeof(int32_t);
+  uint32_t header[4] = {LAYOUT_MAGIC, LAYOUT_VERSION, 0, 0};
+  char tmp_path[256];
+  FILE *fw;
+
+  header[2] = (uint32_t)(sizeof(header) + sizeof(body) + modes + count * sizeof(uint32_t));
+  header[3] = fnv1a(FNV_BASIS, body, sizeof(body));
+  header[3] = fnv1a(header[3], config->ship_mode, modes);
+  header[3] = fnv1a(header[3], layouts->ships, count * sizeof(uint32_t));
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  if ((fw = fopen(tmp_path, "wb")) == NULL)
+    return -1;
+  bool ok = fwrite(header, sizeof(header), 1, fw) == 1 && fwrite(body, sizeof(body), 1, fw) == 1 &&
+            fwrite(config->ship_mode, 1, modes, fw) == modes &&
+            fwrite(layouts->ships, sizeof(uint32_t), count, fw) == count;
+  if (fclose(fw) != 0 || !ok) {
+    remove(tmp_path);
+    return -1;
+  }
+  return rename(tmp_path, path) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Check a fleet before play and get layouts to start its games from.
+ *
+ * Results are cached in @c LAYOUT_CACHE by configuration hash. Without a cache file
+ * the fleet is checked with @c layout_check() and a pool of layouts is generated.
+ * A fleet that random placement manages to lay out fits even if the check gave up.
+ * Sparse fleets get no pool, random placement is as fast as a pool there.
+ * Undecided fleets aren't cached, so the next run tries again.
+ *
+ * @param layouts Target Layouts, release with @c layout_free()
+ * @param config Board Size and Fleet
+ * @return int 0 if games can start, -1 if there is no layout or out of memory
+ */
+int layout_prepare(Layouts *layouts, const Config *config) {
+  char path[64];
+  bool laid_out, sparse = layout_sparse(config);
+  uint32_t *first = malloc(config->ship_total * sizeof(uint32_t));
+
+  memset(layouts, 0, sizeof(*layouts));
+  layouts->verdict = LAYOUT_UNKNOWN;
+  layouts->hash = config_hash(config);
+  layouts->game_range = config->game_range;
+  layouts->ship_total = config->ship_total;
+  snprintf(path, sizeof(path), LAYOUT_CACHE, layouts->hash);
+  if (layout_load(layouts, config, path) == 0) {
+    free(first);
+    return layouts->count > 0 || (sparse && layouts->verdict == LAYOUT_FEASIBLE) ? 0 : -1;
+  }
+
+  layouts->ships = malloc((size_t)LAYOUT_POOL * config->ship_total * sizeof(uint32_t));
+  if (first == NULL || layouts->ships == NULL) {
+    free(first);
+    layout_free(layouts);
+    return -1;
+  }
+  layouts->verdict = layout_decide(config, first, &laid_out);
+  if (sparse) {
+    free(first);
+    if (layouts->verdict != LAYOUT_UNKNOWN)
+      layout_save(layouts, config, path);
+    // random placement in the game settles an undecided sparse fleet
+    return layouts->verdict != LAYOUT_INFEASIBLE ? 0 : -1;
+  }
+  if (layouts->verdict != LAYOUT_INFEASIBLE && layout_generate(layouts, config) != 0) {
+    free(first);
+    layout_free(layouts);
+    return -1;
+  }
+  if (layouts->count == 0 && laid_out) {
+    memcpy(layouts->ships, first, config->ship_total * sizeof(uint32_t));
+    layouts->count = 1;
+  }
+  if (layouts->count > 0)
+    layouts->verdict = LAYOUT_FEASIBLE;
+  free(first);
+  // a missing cache only costs time
+  if (layouts->verdict != LAYOUT_UNKNOWN)
+    layout_save(layouts, config, path);
+  return layouts->count > 0 ? 0 : -1;
+}
+
+/**
+ * @brief Map a field onto one of the eight symmetries of the board.
+ *
+ * @param symmetry Bit 0 mirrors along the diagonal, bit 1 flips the rows, bit 2 the columns
+ * @param n Board Dimension
+ * @param row Row, mapped in place
+ * @param col Column, mapped in place
+ */
+static void layout_turn(int symmetry, int n, int *row, int *col) {
+  if (symmetry & 1) {
+    int tmp = *row;
+    *row = *col;
+    *col = tmp;
+  }
+  if (symmetry & 2)
+    *row = n - 1 - *row;
+  if (symmetry & 4)
+    *col = n - 1 - *col;
+}
+
+/**
+ * @brief Place a fleet from a random layout under a random symmetry of the board.
+ *
+ * @param layouts Source Layouts with at least one layout
+ * @param game_board Target Board, cleared
+ * @param ship_mode Ship Lengths in fleet order
+ * @return int 0 on success, -1 when out of memory
+ */
+int layout_place(const Layouts *layouts, Board *game_board, const int *ship_mode) {
+  const uint32_t *layout = layouts->ships + (size_t)inRange(0, layouts->count - 1) * layouts->ship_total;
+  int symmetry = inRange(0, 7), n = layouts->game_range;
+
+  for (int j = 0; j < layouts->ship_total; j++) {
+    int row = (int)(layout[j] >> 16), col = (int)(layout[j] >> 1 & 0x7fff), dir = (int)(layout[j] & 1);
+    int end_row = row + (dir == 1 ? ship_mode[j] - 1 : 0), end_col = col + (dir == 0 ? ship_mode[j] - 1 : 0);
+    layout_turn(symmetry, n, &row, &col);
+    layout_turn(symmetry, n, &end_row, &end_col);
+    Coordinate pos = {row < end_row ? row : end_row, col < end_col ? col : end_col};
+    if (board_fill(game_board, ship_type_default, pos, ship_mode[j], row != end_row, j) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Release the layouts of a configuration.
+ *
+ * @param layouts Target Layouts
+ */
+void layout_free(Layouts *layouts) {
+  free(layouts->ships);
+  layouts->ships = NULL;
+  layouts->count = 0;
+}
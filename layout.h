@@ -0,0 +1,52 @@
+#include "game.h"
+
+#ifndef BATTLESHIPS_LAYOUT_H
+#define BATTLESHIPS_LAYOUT_H
+
+#include <stdint.h>
+
+/* "BSLY" read as a native integer, see snapshot.h */
+#define LAYOUT_MAGIC 0x594c5342u
+#define LAYOUT_VERSION 1
+/* cache file in the working directory, named after the configuration hash */
+#define LAYOUT_CACHE "fleet-%08x.layouts"
+/* layouts generated per configuration */
+#define LAYOUT_POOL 32
+/* fleets covering less than this share of the board are left to random placement */
+#define LAYOUT_SPARSE 64
+/* nodes the exact search visits before it gives up */
+#define LAYOUT_NODES 20000000L
+/* the exact search keeps every row of the board and its halo column in 64 bits */
+#define LAYOUT_SEARCH_RANGE 63
+/* largest board the arrangement count decides fleets on when the search gave up */
+#define LAYOUT_COUNT_RANGE 13
+
+/*
+ * Verdicts of layout_check().
+ */
+#define LAYOUT_UNKNOWN -1
+#define LAYOUT_INFEASIBLE 0
+#define LAYOUT_FEASIBLE 1
+
+/*
+ * Valid fleet layouts of one configuration. Every layout holds one placement per ship
+ * in fleet order, packed as row << 16 | col << 1 | direction. Games take a random
+ * layout and turn it with a random symmetry of the board, see layout_place().
+ */
+typedef struct layouts {
+  uint32_t hash;
+  int game_range;
+  int ship_total;
+  int verdict;
+  int count;
+  uint32_t *ships;
+  /* read from the cache file */
+  bool loaded;
+} Layouts;
+
+int layout_check(const Config *config, uint32_t *found);
+int layout_prepare(Layouts *layouts, const Config *config);
+int layout_place(const Layouts *layouts, Board *game_board, const int *ship_mode);
+void layout_free(Layouts *layouts);
+
+#endif //BATTLESHIPS_LAYOUT_H
@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "loadgen.h"
+
+/*
+ * One load generator connection playing games back to back.
+ */
+typedef struct client {
+  int fd;
+  int range;
+  int next;
+  int *order;
+  /* fields known to be water around sunk ships */
+  unsigned char *known;
+  struct timespec sent;
+  char in[SERVER_LINE];
+  int in_len;
+} Client;
+
+/**
+ * @brief Nanoseconds between two points in time.
+ *
+ * @param from Start
+ * @param to End
+ * @return long
+ */
+static long elapsed_ns(struct timespec from, struct timespec to) {
+  return (to.tv_sec - from.tv_sec) * 1000000000L + (to.tv_nsec - from.tv_nsec);
+}
+
+/**
+ * @brief Send a command line and remember when it was sent.
+ *
+ * @param c Target Client
+ * @param line Command Line
+ * @return int 0 on success, -1 on error
+ */
+static int client_send(Client *c, const char *line) {
+  size_t len = strlen(line);
+  clock_gettime(CLOCK_MONOTONIC, &c->sent);
+  return write(c->fd, line, len) == (ssize_t)len ? 0 : -1;
+}
+
+/**
+ * @brief Remember the water around a ship sunk by the client.
+ *
+ * @param c Target Client
+ * @param reply Rest of the SUNK reply: row, column, length and direction
+ */
+static void client_sunk(Client *c, const char *reply) {
+  int row, col, size;
+  char dir;
+
+  if (sscanf(reply, "%d %d %d %c", &row, &col, &size, &dir) != 4)
+    return;
+  int rows = dir == 'v' ? size : 1, cols = dir == 'v' ? 1 : size;
+  for (int x = row - 2; x <= row - 1 + rows; x++) {
+    for (int y = col - 2; y <= col - 1 + cols; y++) {
+      if (x >= 0 && x < c->range && y >= 0 && y < c->range)
+        c->known[x * c->range + y] = 1;
+    }
+  }
+}
+
+/**
+ * @brief Fire at the next field of the shuffled board.
+ *
+ * Skips fields known to be water.
+ *
+ * @param c Target Client
+ * @return int 0 on success, -1 on error, 1 if no field is left
+ */
+static int client_fire(Client *c) {
+  char line[SERVER_LINE];
+
+  while (c->next < c->range * c->range && c->known[c->order[c->next]])
+    c->next++;
+  if (c->next == c->range * c->range)
+    return 1;
+  int cell = c->order[c->next++];
+
+  snprintf(line, sizeof(line), "FIRE %d %d\n", cell / c->range + 1, cell % c->range + 1);
+  return client_send(c, line);
+}
+
+/**
+ * @brief Check that a server answers an overlong command line exactly once.
+ *
+ * Sends a line of several input buffers followed by ID and counts the errors
+ * before the ID reply. Waits at most @c LOADGEN_TIMEOUT seconds for each reply.
+ *
+ * @param address Server Address, see @c net_connect()
+ * @return int 0 if the server passed, -1 if not or on error
+ */
+int loadgen_check(const char *address) {
+  struct timeval timeout = {LOADGEN_TIMEOUT, 0};
+  char line[4 * SERVER_LINE], in[SERVER_OUTBUF];
+  int in_len = 0, errors = 0, fd = net_connect(address);
+
+  if (fd < 0)
+    return -1;
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0) {
+    close(fd);
+    return -1;
+  }
+  memset(line, 'x', sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\n';
+  if (write(fd, line, sizeof(line)) != (ssize_t)sizeof(line) || write(fd, "ID\n", 3) != 3) {
+    close(fd);
+    return -1;
+  }
+  for (;;) {
+    ssize_t r = read(fd, in + in_len, sizeof(in) - 1 - in_len);
+    if (r <= 0)
+      break;
+    in_len += r;
+    in[in_len] = '\0';
+    if (strstr(in, "ID ") != NULL)
+      break;
+  }
+  for (char *p = in; (p = strstr(p, "ERR line")) != NULL; p++) {
+    errors++;
+  }
+  close(fd);
+  return strstr(in, "ID ") != NULL && errors == 1 ? 0 : -1;
+}
+
+/**
+ * @brief Measure a game server with many concurrent clients.
+ *
+ * Every connection plays games against the CPU back to back, shooting the board in a
+ * random order. Prints games per second and percentiles of the turn latency, which is
+ * the time from sending a shot until the reply including the CPU shot arrived.
+ *
+ * @param address Server Address, see @c net_connect()
+ * @param games Games to play in total
+ * @param connections Concurrent Connections
+ * @param mode Game Mode
+ * @return int 0 on success, -1 on error
+ */
+int loadgen_run(const char *address, int games, int connections, int mode) {
+  struct epoll_event ev, events[SERVER_EVENTS];
+  struct timespec start, now;
+  char cmd_new[SERVER_LINE];
+  int started = 0, finished = 0, errors = 0, active = 0;
+  Histogram *lat = calloc(1, sizeof(Histogram));
+  Client *clients = calloc(connections, sizeof(Client));
+  int ep = epoll_create1(0);
+
+  if (lat == NULL || clients == NULL || ep < 0) {
+    fprintf(stderr, "Out of Memory\n");
+    free(lat);
+    free(clients);
+    return -1;
+  }
+  snprintf(cmd_new, sizeof(cmd_new), "NEW %d\n", mode);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  for (int i = 0; i < connections && started < games; i++) {
+    Client *c = &clients[i];
+    if ((c->fd = net_connect(address)) < 0) {
+      fprintf(stderr, "Could not connect to %s\n", address);
+      break;
+    }
+    ev.events = EPOLLIN;
+    ev.data.ptr = c;
+    epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev);
+    active++;
+    started++;
+    client_send(c, cmd_new);
+  }
+
+  while (active > 0) {
+    int n = epoll_wait(ep, events, SERVER_EVENTS, -1);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    for (int i = 0; i < n; i++) {
+      Client *c = events[i].data.ptr;
+      ssize_t r = read(c->fd, c->in + c->in_len, SERVER_LINE - c->in_len);
+      bool done = r <= 0;
+      char *start_line = c->in, *end;
+
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      if (r > 0)
+        c->in_len += r;
+      while (!done && (end = memchr(start_line, '\n', c->in + c->in_len - start_line)) != NULL) {
+        *end = '\0';
+        if (strncmp(start_line, "OK ", 3) == 0) {
+          // new game, shuffle the board
+          c->range = (int)strtol(start_line + 3, NULL, 10);
+          free(c->order);
+          free(c->known);
+          c->known = calloc(c->range * c->range, 1);
+          if ((c->order = malloc(c->range * c->range * sizeof(int))) == NULL || c->known == NULL) {
+            done = true;
+            break;
+          }
+          for (int k = 0; k < c->range * c->range; k++) {
+            int j = inRange(0, k);
+            c->order[k] = c->order[j];
+            c->order[j] = k;
+          }
+          c->next = 0;
+          done = client_fire(c) != 0;
+        } else {
+          hist_record(lat, elapsed_ns(c->sent, now));
+          if (strncmp(start_line, "ERR", 3) == 0)
+            errors++;
+          if (strncmp(start_line, "SUNK ", 5) == 0)
+            client_sunk(c, start_line + 5);
+          if (strncmp(start_line, "WIN", 3) == 0 || strstr(start_line, "LOSE") != NULL) {
+            finished++;
+            if (started < games) {
+              started++;
+              done = client_send(c, cmd_new) != 0;
+            } else {
+              done = true;
+            }
+          } else {
+            done = client_fire(c) != 0;
+          }
+        }
+        start_line = end + 1;
+      }
+      c->in_len -= start_line - c->in;
+      memmove(c->in, start_line, c->in_len);
+      if (done) {
+        epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        free(c->order);
+        free(c->known);
+        c->order = NULL;
+        c->known = NULL;
+        active--;
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  close(ep);
+
+  double secs = elapsed_ns(start, now) / 1e9;
+  printf("games: %d, turns: %ld, errors: %d\n", finished, lat->count, errors);
+  printf("elapsed: %.3f s, %.1f sessions/s, %.1f turns/s\n", secs, finished / secs, lat->count / secs);
+  if (lat->count > 0) {
+    printf("turn latency (us): p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+           hist_percentile(lat, 50.0) / 1e3, hist_percentile(lat, 90.0) / 1e3, hist_percentile(lat, 99.0) / 1e3,
+           hist_percentile(lat, 99.9) / 1e3, lat->max / 1e3);
+  }
+  free(lat);
+  free(clients);
+  return finished == games ? 0 : -1;
+}
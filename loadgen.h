@@ -0,0 +1,13 @@
+#include "server.h"
+#include "hist.h"
+
+#ifndef BATTLESHIPS_LOADGEN_H
+#define BATTLESHIPS_LOADGEN_H
+
+/* seconds loadgen_check() waits for a reply */
+#define LOADGEN_TIMEOUT 5
+
+int loadgen_run(const char *address, int games, int connections, int mode);
+int loadgen_check(const char *address);
+
+#endif //BATTLESHIPS_LOADGEN_H
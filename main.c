@@ -11,96 +11,307 @@
 
 #include "battleship.h"
 #include "helpers.h"
+#include "snapshot.h"
+#include "engine.h"
+#include "server.h"
+#include "loadgen.h"
+#include "simulate.h"
+#include "script.h"
+#include "config.h"
+#include "kernel.h"
+#include "shard.h"
+#include "arrange.h"
+#include "layout.h"
 
-int main(int argc, char *argv[]) {
-  int game_mode, player_total, player_current, direct, hitype, hitship, game_round = 0, sub_round = 1;
-  int hit_total = 0, hit_count[2] = {0};
-
-  int ship_mode[MAX_SHIPS] = {2, 2, 3, 3, 4, 5, 4};
-
-  int ship_sunk[2][MAX_SHIPS] = {{2, 2, 3, 3, 4, 5, 4}, {2, 2, 3, 3, 4, 5, 4}};
+/**
+ * @brief Check a fleet from the board options before play and attach its layouts.
+ *
+ * Bad fleets fail right away, see @c layout_prepare().
+ *
+ * @param config Target Config
+ * @param layouts Layouts of the fleet, release with @c layout_free()
+ * @return int 0 on success, -1 if the fleet doesn't fit or couldn't be placed
+ */
+static int fleet_prepare(Config *config, Layouts *layouts) {
+  if (layout_prepare(layouts, config) != 0) {
+    if (layouts->verdict == LAYOUT_INFEASIBLE) {
+      fprintf(stderr, "Fleet doesn't fit the board\n");
+    } else if (layouts->verdict == LAYOUT_FEASIBLE) {
+      fprintf(stderr, "Fleet fits the board but couldn't be placed\n");
+    } else {
+      fprintf(stderr, "Fleet couldn't be placed, it may not fit the board\n");
+    }
+    return -1;
+  }
+  // sparse fleets keep random placement
+  config->layouts = layouts->count > 0 ? layouts : NULL;
+  return 0;
+}
 
-  WaterCraft ship_type[4] = {
-      {2, 's', "small", "Submarine"},
-      {3, 'c', "medium", "Cruiser"},
-      {4, 'b', "large", "Battleship"},
-      {5, 'r', "huge", "Carrier"},
-  };
+int main(int argc, char *argv[]) {
+  int game_mode, player_total;
+  WaterCraft *ship_type = ship_type_default;
   Coordinate target;
   // needs bigger buffer or bleeds into next input
   char tmp[3], *tmp_;
 
-  Stats pstats_[2] = {0};
+  Engine engine = {0};
+  Game *game = &engine.game;
+  const Event *events;
+  int event_count;
+  // autosave after every turn, resume with -r [file]
+  const char *snapshot_path = SNAPSHOTFILE;
+  bool resume = false;
+  Config config = {0};
+  const char *fleet = NULL;
+  int arg = 1, size = 0;
+  Layouts layouts = {0};
+  bool custom;
 
-  /*
-   * GAME START
-   * */
-  printf("####### BATTLESHIPS #######\n");
-  printf("\nHow many human players are participating [1] or [2]?\n");
-  // scanf("%d", &players);
-  printf(">Enter Option:");
-  do {
-    fgets(tmp, sizeof(tmp), stdin);
-    player_total = (int)strtol(tmp, &tmp_, 0);
-  } while (player_total <= 0 || player_total > 2);
-  if (*tmp_ != '\n' && *tmp_ != '\0') {
-    fprintf(stderr, "Invalid input\n");
+  // board options: --config <file> or --size <n> [--fleet <list>], --salvo
+  while (arg < argc) {
+    if (strcmp(argv[arg], "--salvo") == 0) {
+      config.salvo = true;
+      arg++;
+      continue;
+    }
+    if (arg + 1 == argc) {
+      break;
+    } else if (strcmp(argv[arg], "--config") == 0) {
+      if (config_load(&config, argv[arg + 1]) != 0)
+        return -1;
+    } else if (strcmp(argv[arg], "--size") == 0) {
+      size = atoi(argv[arg + 1]);
+    } else if (strcmp(argv[arg], "--fleet") == 0) {
+      fleet = argv[arg + 1];
+    } else {
+      break;
+    }
+    arg += 2;
+  }
+  if ((size != 0 || fleet != NULL) && config_fleet(&config, size, fleet) != 0) {
+    fprintf(stderr, "Invalid board size or fleet\n");
     return -1;
   }
+  argc -= arg - 1;
+  argv += arg - 1;
+  // board options given, the fleet is checked before play
+  custom = config.game_range > 0;
 
-  printf("\nChoose game mode:\n");
-  printf("[1] Easy: 5x5 with 3 ships\n");
-  printf("[2] Medium: 7x7 with 4 ships\n");
-  printf("[3] Hard: 10x10 with 5 ships\n");
-  printf("[4] Ultra: 13x13 with 7 ships\n");
-  printf("[0] Exit\n");
-  const int gm[4] = {DEBUG ? 2 : 5, 7, 10, 13};
-  printf(">Enter Option:");
-  do {
-    fgets(tmp, sizeof(tmp), stdin);
-    game_mode = (int)strtol(tmp, &tmp_, 0);
-  } while (game_mode < 0 || game_mode > 4);
-  if (*tmp_ != '\n' && *tmp_ != '\0') {
-    fprintf(stderr, "Invalid input\n");
-    return -1;
+  if (argc > 2 && strcmp(argv[1], "--server") == 0) {
+    // headless game server, see server.h for the protocol
+    if (custom || config.salvo) {
+      fprintf(stderr, "Board options aren't supported with --server\n");
+      return -1;
+    }
+    srand(time(0));
+    return server_run(argv[2]) == 0 ? 0 : -1;
   }
-  if (game_mode == 0)
+  if (argc > 4 && strcmp(argv[1], "--load") == 0) {
+    // load generator: --load <address> <games> <connections> [mode]
+    srand(time(0));
+    return loadgen_run(argv[2], atoi(argv[3]), atoi(argv[4]), argc > 5 ? atoi(argv[5]) : 3) == 0 ? 0 : -1;
+  }
+  if (argc > 2 && strcmp(argv[1], "--check-server") == 0) {
+    // protocol check: --check-server <address>
+    if (loadgen_check(argv[2]) != 0) {
+      fprintf(stderr, "%s doesn't answer an overlong line with a single error\n", argv[2]);
+      return -1;
+    }
+    printf("%s answers an overlong line with a single error\n", argv[2]);
     return 0;
-
-  const int game_range = gm[game_mode - 1];
-  // const int ship_total = (int)ceil((float)game_range / 2);
-  const int ship_total = (game_range / 2) + ((game_range % 2) != 0);
-  /*
-   * GENERATE PLAYFIELDS
-   * */
-  Cell **player_1;
-  Cell **player_2;
-
-  // first dimension
-  player_1 = malloc(game_range * sizeof(int *));
-  if (player_1 == NULL) {
-    fprintf(stderr, "Out of Memory\n");
-    return -1;
   }
-  for (int i = 0; i < game_range; i++) {
-    player_1[i] = malloc(2 * game_range * sizeof(int));
+  if (argc > 2 && strcmp(argv[1], "--simulate") == 0) {
+    // batch run: --simulate <games> [mode] [seed] [histogram file], the mode is ignored with board options
+    SimResult sim;
+    clock_t begin = clock();
+    if (config.game_range == 0 && config_mode(&config, argc > 3 ? atoi(argv[3]) : 3) != 0) {
+      fprintf(stderr, "Invalid game mode\n");
+      return -1;
+    }
+    if (custom && fleet_prepare(&config, &layouts) != 0)
+      return -1;
+    if (sim_run(atoi(argv[2]), &config, argc > 4 ? (unsigned int)strtoul(argv[4], NULL, 0) : (unsigned int)time(0), &sim) != 0) {
+      fprintf(stderr, "Invalid simulation\n");
+      return -1;
+    }
+    config_free(&config);
+    double secs = (double)(clock() - begin) / CLOCKS_PER_SEC;
+    sim_print(&sim, secs);
+    printf("contexts: %ld allocated, %ld games started\n", sim.pool.created, sim.pool.acquired);
+    if (custom && layouts.count == 0)
+      printf("layouts: none, sparse fleet placed at random\n");
+    else if (custom)
+      printf("layouts: %d %s\n", layouts.count, layouts.loaded ? "from cache" : "generated");
+    layout_free(&layouts);
+    if (argc > 5 && sim_export(&sim, argv[5]) != 0) {
+      fprintf(stderr, "Could not write %s\n", argv[5]);
+      return -1;
+    }
+    return 0;
   }
-  board_clear(player_1, game_range);
-  // first dimension
-  player_2 = malloc(game_range * sizeof(int *));
-  if (player_2 == NULL) {
-    fprintf(stderr, "Out of Memory\n");
-    return -1;
+  if (argc > 4 && strcmp(argv[1], "--coordinate") == 0) {
+    // sharded batch run: --coordinate <address> <games> <workers> [mode] [seed] [shard games] [histogram file]
+    SimResult sim;
+    ShardStats shards;
+    if (config.game_range == 0 && config_mode(&config, argc > 5 ? atoi(argv[5]) : 3) != 0) {
+      fprintf(stderr, "Invalid game mode\n");
+      return -1;
+    }
+    if (custom && fleet_prepare(&config, &layouts) != 0)
+      return -1;
+    unsigned int seed = argc > 6 ? (unsigned int)strtoul(argv[6], NULL, 0) : (unsigned int)time(0);
+    if (shard_coordinate(argv[2], &config, atoi(argv[3]), seed, argc > 7 ? atoi(argv[7]) : 1000, atoi(argv[4]), &sim,
+                         &shards) != 0) {
+      fprintf(stderr, "Sharded simulation failed\n");
+      return -1;
+    }
+    config_free(&config);
+    layout_free(&layouts);
+    sim_print(&sim, shards.elapsed);
+    printf("shards: %d, reassigned: %d, workers started: %d\n", shards.shards, shards.reassigned, shards.workers);
+    if (argc > 8 && sim_export(&sim, argv[8]) != 0) {
+      fprintf(stderr, "Could not write %s\n", argv[8]);
+      return -1;
+    }
+    return 0;
+  }
+  if (argc > 2 && strcmp(argv[1], "--work") == 0) {
+    // remote worker of a sharded run: --work <address> [mode], board options have to match the coordinator
+    if (config.game_range == 0 && config_mode(&config, argc > 3 ? atoi(argv[3]) : 3) != 0) {
+      fprintf(stderr, "Invalid game mode\n");
+      return -1;
+    }
+    if (custom && fleet_prepare(&config, &layouts) != 0)
+      return -1;
+    int ret = shard_work(argv[2], &config);
+    config_free(&config);
+    layout_free(&layouts);
+    return ret == 0 ? 0 : -1;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-kernels") == 0) {
+    // specialised against generic board checks: --bench-kernels [rounds]
+    return kernel_bench(argc > 2 ? atoi(argv[2]) : 20000) == 0 ? 0 : -1;
+  }
+  if (argc > 1 && strcmp(argv[1], "--arrangements") == 0) {
+    // count every fleet arrangement: --arrangements [mode] [auto|dp|dfs] [workers]
+    const char *method = argc > 3 ? argv[3] : "auto";
+    uint64_t count;
+    ArrangeStats astats;
+    int workers = argc > 4 ? atoi(argv[4]) : 0, ret;
+    if (config.game_range == 0 && config_mode(&config, argc > 2 ? atoi(argv[2]) : 3) != 0) {
+      fprintf(stderr, "Invalid game mode\n");
+      return -1;
+    }
+    if (strcmp(method, "dp") == 0)
+      ret = arrange_dp(&config, &count, &astats);
+    else if (strcmp(method, "dfs") == 0)
+      ret = arrange_dfs(&config, workers, &count, &astats);
+    else
+      ret = arrange_count(&config, workers, &count, &astats);
+    config_free(&config);
+    if (ret != 0) {
+      fprintf(stderr, "Could not count the arrangements\n");
+      return -1;
+    }
+    printf("arrangements: %llu\n", (unsigned long long)count);
+    if (astats.dfs)
+      printf("search: %d workers, elapsed: %.3f s\n", astats.workers, astats.elapsed);
+    else
+      printf("dynamic program: %ld states per row at most, elapsed: %.3f s\n", astats.states, astats.elapsed);
+    return 0;
+  }
+  if (argc > 2 && strcmp(argv[1], "--script") == 0) {
+    // non-interactive game from a script file, - for stdin
+    return script_run(argv[2]) == 0 ? 0 : -1;
   }
-  for (int i = 0; i < game_range; i++) {
-    player_2[i] = malloc(2 * game_range * sizeof(int));
+  if (argc > 1 && (strcmp(argv[1], "-r") == 0 || strcmp(argv[1], "--resume") == 0)) {
+    resume = true;
+    if (argc > 2)
+      snapshot_path = argv[2];
   }
-  board_clear(player_2, game_range);
+
+  if (!resume && custom) {
+    if (fleet_prepare(&config, &layouts) != 0)
+      return -1;
+    // players place their fleets in board_diag(), only the check is needed
+    layout_free(&layouts);
+    config.layouts = NULL;
+  }
+
+  /*
+   * GAME START
+   * */
+  printf("####### BATTLESHIPS #######\n");
   // 'randomize' seeder based on time
   srand(time(0));
 
-  board_diag(player_1, player_2, ship_type, game_range, player_total, ship_mode,
-             ship_total);
+  if (resume) {
+    if (snapshot_load(game, snapshot_path) != 0) {
+      fprintf(stderr, "Invalid or missing snapshot %s\n", snapshot_path);
+      return -1;
+    }
+    printf("\nResuming game from %s (round %d).\n", snapshot_path, game->sub_round - 1);
+  } else {
+    printf("\nHow many human players are participating [1] or [2]?\n");
+    // scanf("%d", &players);
+    printf(">Enter Option:");
+    do {
+      fgets(tmp, sizeof(tmp), stdin);
+      player_total = (int)strtol(tmp, &tmp_, 0);
+    } while (player_total <= 0 || player_total > 2);
+    if (*tmp_ != '\n' && *tmp_ != '\0') {
+      fprintf(stderr, "Invalid input\n");
+      return -1;
+    }
+
+    if (config.game_range > 0) {
+      game_mode = -1;
+    } else {
+      printf("\nChoose game mode:\n");
+      printf("[1] Easy: 5x5 with 3 ships\n");
+      printf("[2] Medium: 7x7 with 4 ships\n");
+      printf("[3] Hard: 10x10 with 5 ships\n");
+      printf("[4] Ultra: 13x13 with 7 ships\n");
+      printf("[0] Exit\n");
+      printf(">Enter Option:");
+      do {
+        fgets(tmp, sizeof(tmp), stdin);
+        game_mode = (int)strtol(tmp, &tmp_, 0);
+      } while (game_mode < 0 || game_mode > GAME_MODES);
+      if (*tmp_ != '\n' && *tmp_ != '\0') {
+        fprintf(stderr, "Invalid input\n");
+        return -1;
+      }
+      if (game_mode == 0)
+        return 0;
+      config_mode(&config, game_mode);
+    }
+
+    /*
+     * GENERATE PLAYFIELDS
+     * */
+    if (game_init(game, &config, player_total) != 0) {
+      fprintf(stderr, "Out of Memory\n");
+      return -1;
+    }
+    config_free(&config);
+
+    if (board_diag(&game->player[0], &game->player[1], ship_type, game->game_range, game->player_total, game->ship_mode,
+                   game->ship_total) != 0) {
+      fprintf(stderr, "Fleet doesn't fit the board\n");
+      return -1;
+    }
+
+    printf("\nGame starts!\n");
+    game->player_current = inRange(0, 1);
+    printf(">Player %d has been selected to go first.\n\n", game->player_current + 1);
+  }
+
+  Board *player_1 = &game->player[0];
+  Board *player_2 = &game->player[1];
+  const int game_range = game->game_range;
+  Stats *pstats_ = game->pstats_;
 
   if (DEBUG) {
     printf("\n<DEBUG> PLAYER1:\n");
@@ -109,100 +320,56 @@ int main(int argc, char *argv[]) {
     board_print(player_2, player_1, game_range, true);
   }
 
-  printf("\nGame starts!\n");
-  player_current = inRange(0, 1);
-  printf(">Player %d has been selected to go first.\n\n", player_current + 1);
-
-  for (int j = 0; j < ship_total; ++j) {
-    hit_total += ship_mode[j];
-  }
-
   //double hitmissratio;
   //double flatoverflow;
   /*
    * GAME FLOW
    * */
-  while (hit_count[0] != hit_total || hit_count[1] != hit_total) {
-    hitype = 0;
-    game_round++;
-    if ((game_round % 2) == 1) {
+  if (engine_resume(&engine) != 0) {
+    fprintf(stderr, "Out of Memory\n");
+    return -1;
+  }
+  while (engine.state != ENGINE_OVER) {
+    if ((game->game_round % 2) == 0) {
       printf("********************");
-      printf("\n** ROUND %d STARTS\n", sub_round);
+      printf("\n** ROUND %d STARTS\n", game->sub_round);
       printf("********************");
-      sub_round++;
     }
 
-    switch (player_current) {
-    case 0:
-      printf("\nPLAYER %d'S TURN\n", player_current + 1);
+    if (engine.state == ENGINE_CPU) {
+      printf("\nCPU'S TURN\n");
+      engine_step(&engine);
+    } else {
+      printf("\nPLAYER %d'S TURN\n", game->player_current + 1);
+      if (game->salvo)
+        printf(">Salvo of %d shots\n", game_salvo_size(game));
+      // a salvo is fired once all its shots are entered
       do {
         target = getTarget(game_range);
-        hitype = checkShot(player_2, target);
-      } while (hitype == 0);
-      break;
-    case 1:
-      if (player_total == 2) {
-        printf("\nPLAYER %d'S TURN\n", player_current + 1);
-        do {
-          target = getTarget(game_range);
-          hitype = checkShot(player_1, target);
-        } while (hitype == 0);
-        break;
-      } else {
-        printf("\nCPU'S TURN\n");
-        do {
-          direct = inRange(0, 1);
-          target = genCoords(direct, game_range - 1, 0);
-          hitype = checkShot(player_1, target);
-        } while (hitype == 0);
-      }
-      break;
-    default:
-      break;
+      } while (engine_submit(&engine, target) <= 0 && engine.state == ENGINE_SHOT);
+    }
+    // a turn only ends the game without a winner when memory ran out
+    if (engine.state == ENGINE_OVER && !game_won(game)) {
+      fprintf(stderr, "Out of Memory\n");
+      return -1;
     }
-    pstats_[player_current].shots++;
     /*
      * prompts player if it's a hit or miss
      * */
-    if (hitype == 1) {
-      printf("(%d, %d) Target Hit!\n", target.row + 1, target.col + 1);
-      hitship = player_current == 0 ? player_2[target.row][target.col].shipid : player_1[target.row][target.col].shipid;
-      if (hitship > -1) {
-        if (--ship_sunk[!player_current][hitship] == 0) {
-          printf(">>Target Destroyed [Player %d's %s ship (%d cells)]!\n",
-                 !player_current + 1, ship_type[ship_mode[hitship] - 2].size,
-                 ship_mode[hitship]);
-        }
-      }
-      hit_count[player_current]++;
-      pstats_[player_current].hit++;
-    } else {
-      printf("(%d, %d) Target Miss!\n", target.row + 1, target.col + 1);
-      pstats_[player_current].miss++;
-    }
-    // update board symbol
-    if (player_current == 0) {
-      player_2[target.row][target.col].symbol = hitype;
-    } else {
-      player_1[target.row][target.col].symbol = hitype;
-    }
+    engine_print(&engine);
+    events = engine_events(&engine, &event_count);
     /*
      * End of rounds
      * */
-    if (hit_count[player_current] == hit_total) {
-      printf("\n> Player %d wins!\n", player_current + 1);
-      pstats_[player_current].won++;
-      pstats_[!player_current].lost++;
-      for (int c = 0; c < 2; c++) {
-        pstats_[c].total++;
-        pstats_[c].ratio = (pstats_[c].hit == 0 ? 0.0 : (double)pstats_[c].hit / (double)pstats_[c].shots);
-      }
+    if (engine.state == ENGINE_OVER) {
+      // finished games can't be resumed
+      remove(snapshot_path);
       break;
     }
     /*
      * display boards after each round
      */
-    if (player_current == 0) {
+    if (events[0].player == 0) {
       if (NCURS)
       {
         board_printn(player_2, player_1, game_range, DEBUG);
@@ -210,7 +377,7 @@ int main(int argc, char *argv[]) {
         board_print(player_2, player_1, game_range, DEBUG);
       }
     } else {
-      if (player_total == 2) {
+      if (game->player_total == 2) {
         if (NCURS)
         {
           board_printn(player_1, player_2, game_range, DEBUG);
@@ -219,21 +386,15 @@ int main(int argc, char *argv[]) {
         }
       }
     }
-    // alternate players
-    player_current = !player_current;
+    if (snapshot_save(game, snapshot_path) != 0) {
+      fprintf(stderr, "Could not save game to %s\n", snapshot_path);
+    }
   }
 
   /*
    * MEMORY CLEANUP
    * */
-  for (int i = 0; i < game_range; i++) {
-    // free the second dimension
-    free(player_1[i]);
-    free(player_2[i]);
-  }
-  // free memory
-  free(player_1);
-  free(player_2);
+  engine_release(&engine);
 
   player_1 = NULL;
   player_2 = NULL;
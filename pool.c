@@ -0,0 +1,125 @@
+#include "pool.h"
+
+/**
+ * @brief Allocate a new context for the pool.
+ *
+ * @param pool Target Pool
+ * @return Engine* NULL when out of memory
+ */
+static Engine *pool_create(Pool *pool) {
+  Engine *engine = malloc(sizeof(Engine));
+
+  if (engine == NULL)
+    return NULL;
+  if (engine_alloc(engine, pool->config) != 0) {
+    free(engine);
+    return NULL;
+  }
+  pool->stats.created++;
+  return engine;
+}
+
+/**
+ * @brief Make room for another idle context.
+ *
+ * @param pool Target Pool
+ * @return int 0 on success, -1 when out of memory
+ */
+static int pool_grow(Pool *pool) {
+  if (pool->idle_count < pool->idle_cap)
+    return 0;
+  int cap = pool->idle_cap ? 2 * pool->idle_cap : 16;
+  Engine **tmp = realloc(pool->idle, cap * sizeof(Engine *));
+  if (tmp == NULL)
+    return -1;
+  pool->idle = tmp;
+  pool->idle_cap = cap;
+  return 0;
+}
+
+/**
+ * @brief Set up a pool and allocate its first contexts.
+ *
+ * @param pool Target Pool
+ * @param config Board Size and Fleet, must outlive the pool
+ * @param size Contexts to allocate up front
+ * @return int 0 on success, -1 when out of memory
+ */
+int pool_init(Pool *pool, const Config *config, int size) {
+  memset(pool, 0, sizeof(*pool));
+  pool->config = config;
+  for (int i = 0; i < size; i++) {
+    Engine *engine;
+    if (pool_grow(pool) != 0 || (engine = pool_create(pool)) == NULL) {
+      pool_free(pool);
+      return -1;
+    }
+    pool->idle[pool->idle_count++] = engine;
+  }
+  return 0;
+}
+
+/**
+ * @brief Start a new game on a recycled context.
+ *
+ * Takes an idle context or allocates one if the pool is empty, then starts the game
+ * with @c engine_restart().
+ *
+ * @param pool Source Pool
+ * @param player_total Player Counter (no CPU)
+ * @return Engine* NULL when out of memory or the fleet doesn't fit, hand back with @c pool_release()
+ */
+Engine *pool_acquire(Pool *pool, int player_total) {
+  Engine *engine = pool->idle_count > 0 ? pool->idle[--pool->idle_count] : pool_create(pool);
+
+  if (engine == NULL)
+    return NULL;
+  if (engine_restart(engine, player_total) != 0) {
+    // the fleet didn't fit this time, keep the context
+    if (pool_grow(pool) == 0) {
+      pool->idle[pool->idle_count++] = engine;
+    } else {
+      engine_destroy(engine);
+    }
+    return NULL;
+  }
+  pool->stats.acquired++;
+  if (++pool->stats.in_use > pool->stats.peak)
+    pool->stats.peak = pool->stats.in_use;
+  return engine;
+}
+
+/**
+ * @brief Hand a context back to the pool.
+ *
+ * The game is dropped, its memory is kept for the next one.
+ *
+ * @param pool Target Pool
+ * @param engine Context from @c pool_acquire()
+ */
+void pool_release(Pool *pool, Engine *engine) {
+  pool->stats.released++;
+  pool->stats.in_use--;
+  if (pool_grow(pool) != 0) {
+    engine_destroy(engine);
+    return;
+  }
+  pool->idle[pool->idle_count++] = engine;
+}
+
+/**
+ * @brief Release all idle contexts of a pool.
+ *
+ * Contexts still in use have to be released to the pool first.
+ *
+ * @param pool Target Pool
+ */
+void pool_free(Pool *pool) {
+  for (int i = 0; i < pool->idle_count; i++) {
+    engine_destroy(pool->idle[i]);
+  }
+  free(pool->idle);
+  pool->idle = NULL;
+  pool->idle_count = 0;
+  pool->idle_cap = 0;
+}
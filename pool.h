@@ -0,0 +1,36 @@
+#include "engine.h"
+
+#ifndef BATTLESHIPS_POOL_H
+#define BATTLESHIPS_POOL_H
+
+/*
+ * Usage counters of a pool.
+ */
+typedef struct pool_stats {
+  long created;  /* contexts allocated */
+  long acquired; /* games started */
+  long released; /* games handed back */
+  int in_use;
+  int peak;      /* most contexts in use at once */
+} PoolStats;
+
+/*
+ * Recycled game contexts for one board size and fleet.
+ * Each context is an engine with boards, ship tables and event buffers allocated
+ * once. Games started from a warm pool allocate nothing. Pools are not shared
+ * between threads, every worker keeps its own.
+ */
+typedef struct pool {
+  const Config *config;
+  Engine **idle;
+  int idle_count;
+  int idle_cap;
+  PoolStats stats;
+} Pool;
+
+int pool_init(Pool *pool, const Config *config, int size);
+Engine *pool_acquire(Pool *pool, int player_total);
+void pool_release(Pool *pool, Engine *engine);
+void pool_free(Pool *pool);
+
+#endif //BATTLESHIPS_POOL_H
@@ -0,0 +1,413 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "script.h"
+#include "config.h"
+#include "layout.h"
+
+#define SCRIPT_CHUNK 65536
+
+/**
+ * @brief Load a whole script into memory.
+ *
+ * Files are mapped, @c - reads standard input into one buffer.
+ *
+ * @param script Target Script
+ * @param path Script File or @c -
+ * @return int 0 on success, -1 on IO errors
+ */
+int script_open(Script *script, const char *path) {
+  memset(script, 0, sizeof(*script));
+  script->name = path;
+
+  if (strcmp(path, "-") == 0) {
+    size_t cap = 0;
+    while (true) {
+      if (script->size == cap) {
+        char *tmp = realloc(script->buffer, cap + SCRIPT_CHUNK);
+        if (tmp == NULL) {
+          script_close(script);
+          return -1;
+        }
+        script->buffer = tmp;
+        cap += SCRIPT_CHUNK;
+      }
+      size_t n = fread(script->buffer + script->size, 1, cap - script->size, stdin);
+      if (n == 0)
+        break;
+      script->size += n;
+    }
+    script->data = script->buffer;
+    return ferror(stdin) ? -1 : 0;
+  }
+
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return -1;
+  }
+  script->size = (size_t)st.st_size;
+  if (script->size > 0) {
+    script->mapping = mmap(NULL, script->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (script->mapping == MAP_FAILED) {
+      script->mapping = NULL;
+      close(fd);
+      return -1;
+    }
+  }
+  close(fd);
+  script->data = script->mapping;
+  return 0;
+}
+
+/**
+ * @brief Release a script.
+ *
+ * @param script Target Script
+ */
+void script_close(Script *script) {
+  if (script->mapping != NULL)
+    munmap(script->mapping, script->size);
+  free(script->buffer);
+  script->mapping = NULL;
+  script->buffer = NULL;
+  script->data = NULL;
+}
+
+/**
+ * @brief Split the next non empty line into tokens.
+ *
+ * Tokens point into the script, nothing is copied.
+ *
+ * @param script Source Script
+ * @param tokens Target Tokens
+ * @param max Token Capacity
+ * @return int number of tokens on the line (may exceed @c max), 0 at the end of the script
+ */
+int script_next(Script *script, Token *tokens, int max) {
+  const char *data = script->data;
+
+  while (script->pos < script->size) {
+    int n = 0;
+    bool comment = false;
+
+    script->line++;
+    while (script->pos < script->size && data[script->pos] != '\n') {
+      char c = data[script->pos];
+      if (c == '#')
+        comment = true;
+      if (comment || c == ' ' || c == '\t' || c == '\r') {
+        script->pos++;
+        continue;
+      }
+      size_t start = script->pos;
+      while (script->pos < script->size && !isspace((unsigned char)data[script->pos]) && data[script->pos] != '#')
+        script->pos++;
+      if (n < max) {
+        tokens[n].p = data + start;
+        tokens[n].len = (int)(script->pos - start);
+      }
+      n++;
+    }
+    script->pos++;
+    if (n > 0)
+      return n;
+  }
+  return 0;
+}
+
+/**
+ * @brief Compare a token with a keyword.
+ *
+ * @param token Source Token
+ * @param word Keyword
+ * @return true
+ * @return false
+ */
+bool script_is(Token token, const char *word) {
+  return (int)strlen(word) == token.len && strncmp(token.p, word, token.len) == 0;
+}
+
+/**
+ * @brief Parse a decimal number.
+ *
+ * @param p Digits
+ * @param len Number of Digits
+ * @param value Parsed Number
+ * @return true
+ * @return false
+ */
+static bool parse_int(const char *p, int len, int *value) {
+  if (len <= 0 || len > 9)
+    return false;
+  *value = 0;
+  for (int i = 0; i < len; i++) {
+    if (!isdigit((unsigned char)p[i]))
+      return false;
+    *value = *value * 10 + (p[i] - '0');
+  }
+  return true;
+}
+
+/**
+ * @brief Parse a token as a positive number.
+ *
+ * @param token Source Token
+ * @param value Parsed Number
+ * @return true
+ * @return false
+ */
+bool script_int(Token token, int *value) {
+  return parse_int(token.p, token.len, value);
+}
+
+/**
+ * @brief Parse a token as @c row,col coordinates.
+ *
+ * Converts the 1 based input to board coordinates like @c getTarget().
+ *
+ * @param token Source Token
+ * @param target Parsed Coordinates
+ * @return true
+ * @return false
+ */
+bool script_coord(Token token, Coordinate *target) {
+  const char *comma = memchr(token.p, ',', token.len);
+
+  if (comma == NULL)
+    return false;
+  if (!parse_int(token.p, (int)(comma - token.p), &target->row) ||
+      !parse_int(comma + 1, (int)(token.p + token.len - comma - 1), &target->col))
+    return false;
+  // offset for user input
+  target->row -= 1;
+  target->col -= 1;
+  return true;
+}
+
+/**
+ * @brief Report a script error with its line number.
+ *
+ * @param script Source Script
+ * @param msg Message
+ * @return int -1
+ */
+static int script_error(const Script *script, const char *msg) {
+  fprintf(stderr, "%s:%d: %s\n", script->name, script->line, msg);
+  return -1;
+}
+
+/**
+ * @brief Let all CPU players on turn take their shots.
+ *
+ * @param script Source Script
+ * @param engine Target Engine
+ * @return int 0 on success, -1 when out of memory
+ */
+static int script_cpu(Script *script, Engine *engine) {
+  while (engine->state == ENGINE_CPU) {
+    // the CPU is on turn, a failing step ran out of memory
+    if (engine_step(engine) < 0)
+      return script_error(script, "out of memory");
+    engine_print(engine);
+  }
+  return 0;
+}
+
+/**
+ * @brief Allocate the boards once the configuration is complete.
+ *
+ * Scripts without size, ship or mode directives play the hard mode.
+ *
+ * @param script Source Script
+ * @param engine Target Engine
+ * @param config Board Size and Fleet
+ * @param players Player Counter (no CPU)
+ * @param seed Random Seed
+ * @return int 0 on success, -1 on errors
+ */
+static int script_setup(Script *script, Engine *engine, Config *config, int players, unsigned int seed) {
+  if (config->game_range == 0)
+    config_mode(config, 3);
+  if (config_finish(config) != 0)
+    return script_error(script, "ships don't fit the board size");
+  if (layout_check(config, NULL) == LAYOUT_INFEASIBLE)
+    return script_error(script, "fleet doesn't fit the board");
+  srand(seed);
+  if (game_init(&engine->game, config, players) != 0)
+    return script_error(script, "out of memory");
+  return 0;
+}
+
+/**
+ * @brief Start the game after the setup directives.
+ *
+ * @param script Source Script
+ * @param engine Target Engine
+ * @param placed Placed Ships per player
+ * @param first First Player, -1 for random
+ * @return int 0 on success, -1 if a fleet is incomplete
+ */
+static int script_start(Script *script, Engine *engine, const int placed[2], int first) {
+  Game *game = &engine->game;
+
+  for (int p = 0; p < 2; p++) {
+    if (placed[p] == 0) {
+      if (board_rand(&game->player[p], ship_type_default, game->game_range, game->ship_mode, game->ship_total, 0) != 0)
+        return script_error(script, "fleet doesn't fit the board");
+    } else if (placed[p] < game->ship_total) {
+      return script_error(script, p == 0 ? "fleet of player 1 incomplete" : "fleet of player 2 incomplete");
+    }
+  }
+  game->player_current = first >= 0 ? first : inRange(0, 1);
+  if (engine_resume(engine) != 0)
+    return script_error(script, "out of memory");
+  return script_cpu(script, engine);
+}
+
+/**
+ * @brief Play a game from a script without any prompts.
+ *
+ * The whole script is loaded at once, see @c Script for the directives. Stops at the
+ * first error and reports it with its line number.
+ *
+ * @param path Script File or @c - for standard input
+ * @return int 0 on success, -1 on errors
+ */
+int script_run(const char *path) {
+  Script script;
+  Token tok[SCRIPT_TOKENS];
+  Engine engine = {0};
+  Game *game = &engine.game;
+  Coordinate target;
+  int n, value, ret = 0;
+  int players = 1, first = -1, last = -1, placed[2] = {0};
+  unsigned int seed = (unsigned int)time(0);
+  bool setup = false, started = false;
+  Config config = {0};
+  const char *error = NULL;
+
+  if (script_open(&script, path) != 0) {
+    fprintf(stderr, "Could not read script %s\n", path);
+    return -1;
+  }
+
+  while (ret == 0 && (n = script_next(&script, tok, SCRIPT_TOKENS)) > 0) {
+    if (n > SCRIPT_TOKENS) {
+      ret = script_error(&script, "too many arguments");
+    } else if (script_is(tok[0], "seed") || script_is(tok[0], "players")) {
+      if (n != 2 || !script_int(tok[1], &value)) {
+        ret = script_error(&script, "expected a number");
+      } else if (setup) {
+        ret = script_error(&script, "game already set up");
+      } else if (script_is(tok[0], "seed")) {
+        seed = (unsigned int)value;
+      } else {
+        if (value > 2)
+          ret = script_error(&script, "players must be 0-2");
+        players = value;
+      }
+      continue;
+    } else if (!setup && (value = config_directive(&config, tok, n, &error)) != 0) {
+      if (value < 0)
+        ret = script_error(&script, error);
+      continue;
+    }
+    if (ret != 0)
+      break;
+
+    // everything below needs the boards
+    if (!setup) {
+      if ((ret = script_setup(&script, &engine, &config, players, seed)) != 0)
+        break;
+      setup = true;
+    }
+
+    if (script_is(tok[0], "place")) {
+      int dir = n == 4 && script_is(tok[3], "v");
+      if (n != 4 || !script_int(tok[1], &value) || value < 1 || value > 2 || !script_coord(tok[2], &target) ||
+          !(script_is(tok[3], "h") || script_is(tok[3], "v"))) {
+        ret = script_error(&script, "expected place <1|2> <r,c> <h|v>");
+      } else if (started) {
+        ret = script_error(&script, "game already started");
+      } else if (placed[value - 1] == game->ship_total) {
+        ret = script_error(&script, "fleet already placed");
+      } else {
+        int i = placed[value - 1];
+        if (target.row < 0 || target.row >= game->game_range || target.col < 0 || target.col >= game->game_range ||
+            !isvalid(&game->player[value - 1], target, game->game_range, dir, game->ship_mode[i], i)) {
+          ret = script_error(&script, "invalid ship position");
+        } else if (board_fill(&game->player[value - 1], ship_type_default, target, game->ship_mode[i], dir, i) != 0) {
+          ret = script_error(&script, "out of memory");
+        } else {
+          placed[value - 1]++;
+        }
+      }
+    } else if (script_is(tok[0], "first")) {
+      if (n != 2 || !script_int(tok[1], &value) || value < 1 || value > 2) {
+        ret = script_error(&script, "expected first <1|2>");
+      } else if (started) {
+        ret = script_error(&script, "game already started");
+      } else {
+        first = value - 1;
+      }
+    } else if (script_is(tok[0], "fire")) {
+      if (n != 2 || !script_coord(tok[1], &target)) {
+        ret = script_error(&script, "expected fire <r,c>");
+        break;
+      }
+      if (!started) {
+        if ((ret = script_start(&script, &engine, placed, first)) != 0)
+          break;
+        started = true;
+      }
+      if (engine.state != ENGINE_SHOT) {
+        ret = script_error(&script, "no shot expected, game is over");
+      } else if ((value = engine_submit(&engine, target)) < 0) {
+        // a shot is only refused after it was taken when memory ran out
+        ret = script_error(&script, engine.state == ENGINE_OVER ? "out of memory" : "invalid target");
+      } else if (value > 0) {
+        // salvos resolve once the last shot is in
+        engine_print(&engine);
+        // a salvo counts with its strongest outcome
+        last = EVENT_MISS;
+        for (int e = 0; e < value; e++) {
+          if (engine.events[e].type <= EVENT_WIN && engine.events[e].type > last)
+            last = engine.events[e].type;
+        }
+        ret = script_cpu(&script, &engine);
+      }
+    } else if (script_is(tok[0], "expect")) {
+      const char *name[4] = {"miss", "hit", "sunk", "win"};
+      if (n != 2) {
+        ret = script_error(&script, "expected expect <miss|hit|sunk|win>");
+      } else if (last < 0 || !script_is(tok[1], name[last])) {
+        ret = script_error(&script, "expectation failed");
+      }
+    } else {
+      ret = script_error(&script, "unknown directive");
+    }
+  }
+
+  if (ret == 0 && !setup) {
+    ret = script_setup(&script, &engine, &config, players, seed);
+    setup = ret == 0;
+  }
+  if (ret == 0 && !started)
+    ret = script_start(&script, &engine, placed, first);
+  if (ret == 0 && engine.state != ENGINE_OVER)
+    printf("\n> Script ended before the game was over.\n");
+
+  if (setup)
+    engine_release(&engine);
+  config_free(&config);
+  script_close(&script);
+  return ret;
+}
@@ -0,0 +1,49 @@
+#include "engine.h"
+
+#ifndef BATTLESHIPS_SCRIPT_H
+#define BATTLESHIPS_SCRIPT_H
+
+#define SCRIPT_TOKENS 4
+
+/*
+ * Game script, one directive per line. Everything after '#' is a comment.
+ *
+ *   seed <n>              random seed, default is the current time
+ *   players <0-2>         human players, the CPU plays the others
+ *   mode <1-4>            game mode like in the menu
+ *   size <n>, ship <length> [count], salvo  custom board, fleet and rules, see config.h
+ *   place <1|2> <r,c> <h|v>  place the next ship of the player's fleet
+ *   first <1|2>           player to go first, default is random
+ *   fire <r,c>            shot of the human player on turn, CPU turns run in between;
+ *                         under salvo rules the salvo is fired with its last shot
+ *   expect <miss|hit|sunk|win>  check the result of the last shot, or the strongest
+ *                         result of a salvo: a salvo that sinks a ship and then misses
+ *                         is sunk
+ *
+ * Fleets without any place directive are placed randomly when the game starts.
+ */
+typedef struct token {
+  const char *p;
+  int len;
+} Token;
+
+typedef struct script {
+  const char *name;
+  const char *data;
+  size_t size;
+  size_t pos;
+  int line;
+  /* mapped file or buffer read from stdin */
+  void *mapping;
+  char *buffer;
+} Script;
+
+int script_open(Script *script, const char *path);
+void script_close(Script *script);
+int script_next(Script *script, Token *tokens, int max);
+bool script_is(Token token, const char *word);
+bool script_int(Token token, int *value);
+bool script_coord(Token token, Coordinate *target);
+int script_run(const char *path);
+
+#endif //BATTLESHIPS_SCRIPT_H
@@ -0,0 +1,551 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "config.h"
+
+/* board size and fleet of the built-in game modes */
+static Config server_modes[GAME_MODES];
+/* recycled game contexts per mode */
+static Pool server_pools[GAME_MODES];
+/* event loop, and the sessions by socket for WATCH */
+static int server_ep = -1;
+static Session **server_sessions;
+static int server_session_cap;
+static int server_next_id;
+
+/**
+ * @brief Resolve a socket address.
+ *
+ * Accepts @c unix:/path for Unix sockets, @c host:port or just @c port for TCP on
+ * the loopback interface.
+ *
+ * @param address Address String
+ * @param addr Resolved Address
+ * @return socklen_t address length, 0 if the address is invalid
+ */
+static socklen_t net_address(const char *address, struct sockaddr_storage *addr) {
+  memset(addr, 0, sizeof(*addr));
+
+  if (strncmp(address, "unix:", 5) == 0) {
+    struct sockaddr_un *un = (struct sockaddr_un *)addr;
+    if (strlen(address + 5) >= sizeof(un->sun_path))
+      return 0;
+    un->sun_family = AF_UNIX;
+    strcpy(un->sun_path, address + 5);
+    return sizeof(*un);
+  }
+
+  struct sockaddr_in *in = (struct sockaddr_in *)addr;
+  char host[64] = "127.0.0.1", *tmp_;
+  const char *port = strrchr(address, ':');
+
+  if (port != NULL) {
+    if ((size_t)(port - address) >= sizeof(host))
+      return 0;
+    memcpy(host, address, port - address);
+    host[port - address] = '\0';
+    port++;
+  } else {
+    port = address;
+  }
+  long p = strtol(port, &tmp_, 10);
+  if (*tmp_ != '\0' || p <= 0 || p > 65535)
+    return 0;
+  in->sin_family = AF_INET;
+  in->sin_port = htons((unsigned short)p);
+  if (inet_pton(AF_INET, host, &in->sin_addr) != 1)
+    return 0;
+  return sizeof(*in);
+}
+
+/**
+ * @brief Switch a socket to non blocking mode.
+ *
+ * @param fd Socket
+ * @return int 0 on success, -1 on error
+ */
+int net_nonblock(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) ? -1 : 0;
+}
+
+/**
+ * @brief Open a listening socket.
+ *
+ * Stale Unix socket files are removed before binding.
+ *
+ * @param address Address String, see @c net_address()
+ * @return int non blocking socket, -1 on error
+ */
+int net_listen(const char *address) {
+  struct sockaddr_storage addr;
+  socklen_t len = net_address(address, &addr);
+  int one = 1;
+
+  if (len == 0)
+    return -1;
+  int fd = socket(addr.ss_family, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  if (addr.ss_family == AF_UNIX) {
+    unlink(((struct sockaddr_un *)&addr)->sun_path);
+  } else {
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  }
+  if (bind(fd, (struct sockaddr *)&addr, len) != 0 || listen(fd, SERVER_BACKLOG) != 0 || net_nonblock(fd) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * @brief Connect to a listening socket.
+ *
+ * @param address Address String, see @c net_address()
+ * @return int blocking socket, -1 on error
+ */
+int net_connect(const char *address) {
+  struct sockaddr_storage addr;
+  socklen_t len = net_address(address, &addr);
+
+  if (len == 0)
+    return -1;
+  int fd = socket(addr.ss_family, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  if (connect(fd, (struct sockaddr *)&addr, len) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * @brief Queue a reply line for the client.
+ *
+ * @param s Target Session
+ * @param fmt Format String
+ */
+static void session_reply(Session *s, const char *fmt, ...) {
+  va_list args;
+  int room = SERVER_OUTBUF - s->out_len;
+
+  va_start(args, fmt);
+  int n = vsnprintf(s->out + s->out_len, room, fmt, args);
+  va_end(args);
+  if (n > 0)
+    s->out_len += n < room ? n : room - 1;
+}
+
+/**
+ * @brief Poll a session for output until its backlog is written.
+ *
+ * @param s Target Session
+ */
+static void session_poll_out(Session *s) {
+  struct epoll_event ev;
+
+  ev.events = EPOLLOUT;
+  ev.data.ptr = s;
+  epoll_ctl(server_ep, EPOLL_CTL_MOD, s->fd, &ev);
+  s->polling_out = true;
+}
+
+/**
+ * @brief Write the new frames of every spectator of a session.
+ *
+ * Spectators that can't take them right away are polled for output instead.
+ * Errors show up again on the next write from the event loop, which closes them.
+ *
+ * @param channel Spectators of the session
+ */
+static void session_wake(Channel *channel) {
+  for (Subscriber *sub = channel->subs; sub != NULL; sub = sub->next) {
+    Session *w = sub->owner;
+    // the WATCH reply goes first
+    if (!w->polling_out && (w->out_len != 0 || broadcast_flush(sub) != 0))
+      session_poll_out(w);
+  }
+}
+
+/**
+ * @brief Find the session with the given id.
+ *
+ * @param id Session ID, see ID
+ * @return Session* NULL if there is none
+ */
+static Session *session_find(int id) {
+  for (int fd = 0; fd < server_session_cap; fd++) {
+    if (server_sessions[fd] != NULL && server_sessions[fd]->id == id)
+      return server_sessions[fd];
+  }
+  return NULL;
+}
+
+/**
+ * @brief Append the events of the last shot to the reply.
+ *
+ * The spectators of the session get the same events, see broadcast.h.
+ *
+ * @param s Target Session
+ */
+static void session_events(Session *s) {
+  const char *name[4] = {"MISS", "HIT", "SUNK", "WIN"};
+  int count;
+  const Event *events = engine_events(s->engine, &count);
+  int type = events[count - 1].type;
+
+  broadcast_publish(&s->channel, &s->engine->game, events, count);
+  session_wake(&s->channel);
+
+  // SUNK and WIN follow the HIT, report only the strongest
+  if (events[0].player == 0) {
+    session_reply(s, "%s", name[type]);
+    if (type == EVENT_SUNK) {
+      const Ship *ship = &s->engine->game.player[1].ships[events[count - 1].ship];
+      session_reply(s, " %d %d %d %c", ship->position.row + 1, ship->position.col + 1, ship->size,
+                    ship->direction == 0 ? 'h' : 'v');
+    }
+  } else {
+    session_reply(s, " CPU %d %d %s", events[0].target.row + 1, events[0].target.col + 1,
+                  type == EVENT_WIN ? "LOSE" : name[type]);
+  }
+}
+
+/**
+ * @brief Let the CPU fire if it's on turn.
+ *
+ * @param s Target Session
+ */
+static void session_cpu(Session *s) {
+  if (engine_step(s->engine) > 0)
+    session_events(s);
+  if (s->engine->state == ENGINE_OVER)
+    s->state = SESSION_OVER;
+}
+
+/**
+ * @brief Execute one command line of a client.
+ *
+ * @param s Target Session
+ * @param line Command Line
+ * @return int 0 to keep the connection, -1 to close it
+ */
+static int session_command(Session *s, const char *line) {
+  Engine *engine = s->engine;
+  int mode, row, col, id;
+
+  if (s->watching) {
+    // spectators only get the stream
+    return strncmp(line, "QUIT", 4) == 0 ? -1 : 0;
+  }
+  if (sscanf(line, "NEW %d", &mode) == 1) {
+    if (mode <= 0 || mode > GAME_MODES) {
+      session_reply(s, "ERR mode\n");
+      return 0;
+    }
+    if (s->state != SESSION_IDLE)
+      pool_release(&server_pools[s->mode - 1], engine);
+    s->engine = engine = pool_acquire(&server_pools[mode - 1], 1);
+    broadcast_reset(&s->channel, engine != NULL ? &engine->game : NULL);
+    session_wake(&s->channel);
+    if (engine == NULL) {
+      s->state = SESSION_IDLE;
+      session_reply(s, "ERR memory\n");
+      return 0;
+    }
+    s->mode = mode;
+    s->state = SESSION_TURN;
+    session_reply(s, "OK %d %d", engine->game.game_range, engine->game.hit_total);
+    session_cpu(s);
+    session_reply(s, "\n");
+  } else if (sscanf(line, "FIRE %d%*[ ,]%d", &row, &col) == 2) {
+    if (s->state != SESSION_TURN) {
+      session_reply(s, "ERR state\n");
+      return 0;
+    }
+    Coordinate target = {row - 1, col - 1};
+    if (engine_submit(engine, target) < 0) {
+      // the engine ends the game when memory ran out
+      if (engine->state == ENGINE_OVER) {
+        s->state = SESSION_OVER;
+        session_reply(s, "ERR memory\n");
+      } else {
+        session_reply(s, "ERR target\n");
+      }
+      return 0;
+    }
+    session_events(s);
+    if (engine->state == ENGINE_OVER) {
+      s->state = SESSION_OVER;
+    } else {
+      session_cpu(s);
+    }
+    session_reply(s, "\n");
+  } else if (strncmp(line, "STATS", 5) == 0) {
+    PoolStats sum = {0};
+    for (int m = 0; m < GAME_MODES; m++) {
+      sum.created += server_pools[m].stats.created;
+      sum.acquired += server_pools[m].stats.acquired;
+      sum.in_use += server_pools[m].stats.in_use;
+      sum.peak += server_pools[m].stats.peak;
+    }
+    session_reply(s, "STATS %ld %ld %d %d\n", sum.created, sum.acquired, sum.in_use, sum.peak);
+  } else if (strncmp(line, "ID", 2) == 0) {
+    session_reply(s, "ID %d\n", s->id);
+  } else if (sscanf(line, "WATCH %d", &id) == 1) {
+    Session *target = session_find(id);
+    if (s->state != SESSION_IDLE) {
+      session_reply(s, "ERR state\n");
+      return 0;
+    }
+    if (target == NULL || target == s || target->watching) {
+      session_reply(s, "ERR game\n");
+      return 0;
+    }
+    if (broadcast_subscribe(&target->channel, &s->watch, target->state != SESSION_IDLE ? &target->engine->game : NULL) !=
+        0) {
+      session_reply(s, "ERR memory\n");
+      return 0;
+    }
+    s->watching = true;
+    session_reply(s, "WATCH %d\n", id);
+  } else if (strncmp(line, "QUIT", 4) == 0) {
+    session_reply(s, "BYE\n");
+    return -1;
+  } else {
+    session_reply(s, "ERR unknown\n");
+  }
+  return 0;
+}
+
+/**
+ * @brief Execute all complete command lines in the input buffer.
+ *
+ * Lines longer than the buffer are answered with an error and skipped.
+ *
+ * @param s Target Session
+ * @return int 0 to keep the connection, -1 to close it
+ */
+static int session_process(Session *s) {
+  char *start = s->in, *end;
+  int ret = 0;
+
+  while (ret == 0 && (end = memchr(start, '\n', s->in + s->in_len - start)) != NULL) {
+    *end = '\0';
+    if (end > start && end[-1] == '\r')
+      end[-1] = '\0';
+    if (s->discard) {
+      s->discard = false;
+    } else {
+      ret = session_command(s, start);
+    }
+    start = end + 1;
+  }
+  s->in_len -= start - s->in;
+  memmove(s->in, start, s->in_len);
+  if (s->in_len == SERVER_LINE) {
+    s->in_len = 0;
+    // answer once per line, not once per buffer of it
+    if (!s->discard)
+      session_reply(s, "ERR line\n");
+    s->discard = true;
+  }
+  return ret;
+}
+
+/**
+ * @brief Write pending replies without blocking.
+ *
+ * @param s Target Session
+ * @return int 0 if all was written, 1 if the socket is full, -1 on error
+ */
+static int session_flush(Session *s) {
+  while (s->out_off < s->out_len) {
+    ssize_t n = write(s->fd, s->out + s->out_off, s->out_len - s->out_off);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? 1 : -1;
+    }
+    s->out_off += n;
+  }
+  s->out_off = 0;
+  s->out_len = 0;
+  return 0;
+}
+
+/**
+ * @brief Handle readiness of a client socket.
+ *
+ * Input is only processed while no reply is pending, a slow reader stops being read
+ * until its replies are written.
+ *
+ * @param ep Event Loop
+ * @param s Target Session
+ * @param events Ready Events
+ * @return int 0 to keep the connection, -1 to close it
+ */
+static int session_event(int ep, Session *s, uint32_t events) {
+  int closing = 0, pending;
+
+  if (events & EPOLLERR)
+    return -1;
+  if ((events & (EPOLLIN | EPOLLHUP)) && s->in_len < SERVER_LINE) {
+    ssize_t n = read(s->fd, s->in + s->in_len, SERVER_LINE - s->in_len);
+    if (n == 0)
+      return -1;
+    if (n < 0)
+      return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    s->in_len += n;
+  }
+  if ((pending = session_flush(s)) == 0) {
+    closing = session_process(s);
+    pending = session_flush(s);
+  }
+  if (pending == 0 && s->watching && !closing) {
+    pending = broadcast_flush(&s->watch);
+    // the watched session is gone and its END is written
+    if (pending == 0 && s->watch.ended)
+      return -1;
+  }
+  if (pending < 0 || (closing && pending == 0))
+    return -1;
+
+  struct epoll_event ev;
+  ev.events = pending ? EPOLLOUT : EPOLLIN;
+  ev.data.ptr = s;
+  epoll_ctl(ep, EPOLL_CTL_MOD, s->fd, &ev);
+  s->polling_out = pending != 0;
+  return 0;
+}
+
+/**
+ * @brief Close a client connection and release its game.
+ *
+ * @param s Target Session
+ */
+static void session_close(Session *s) {
+  if (s->watching)
+    broadcast_unsubscribe(&s->watch);
+  // spectators are polled before their END is queued, the loop picks it up
+  for (Subscriber *sub = s->channel.subs; sub != NULL; sub = sub->next) {
+    session_poll_out(sub->owner);
+  }
+  broadcast_close(&s->channel);
+  server_sessions[s->fd] = NULL;
+  close(s->fd);
+  if (s->state != SESSION_IDLE)
+    pool_release(&server_pools[s->mode - 1], s->engine);
+  free(s);
+}
+
+/**
+ * @brief Set up a new client connection.
+ *
+ * @param fd Client Socket
+ * @return Session* NULL when out of memory
+ */
+static Session *session_open(int fd) {
+  Session *s;
+
+  if (fd >= server_session_cap) {
+    int cap = server_session_cap == 0 ? 64 : server_session_cap;
+    while (cap <= fd)
+      cap *= 2;
+    Session **sessions = realloc(server_sessions, cap * sizeof(Session *));
+    if (sessions == NULL)
+      return NULL;
+    memset(sessions + server_session_cap, 0, (cap - server_session_cap) * sizeof(Session *));
+    server_sessions = sessions;
+    server_session_cap = cap;
+  }
+  if ((s = calloc(1, sizeof(Session))) == NULL)
+    return NULL;
+  s->fd = fd;
+  s->id = ++server_next_id;
+  s->state = SESSION_IDLE;
+  broadcast_init(&s->channel);
+  s->watch.fd = fd;
+  s->watch.owner = s;
+  server_sessions[fd] = s;
+  return s;
+}
+
+/**
+ * @brief Host games against the CPU for many clients in one process.
+ *
+ * Single threaded event loop. Every connection is a small state machine which never
+ * blocks, see @c Session for the protocol.
+ *
+ * @param address Listen Address, see @c net_address()
+ * @return int -1 if the server couldn't be started
+ */
+int server_run(const char *address) {
+  struct epoll_event ev, events[SERVER_EVENTS];
+  int lfd, ep;
+
+  signal(SIGPIPE, SIG_IGN);
+  for (int m = 0; m < GAME_MODES; m++) {
+    if (config_mode(&server_modes[m], m + 1) != 0 || pool_init(&server_pools[m], &server_modes[m], 0) != 0)
+      return -1;
+  }
+  if ((lfd = net_listen(address)) < 0) {
+    fprintf(stderr, "Could not listen on %s\n", address);
+    return -1;
+  }
+  if ((ep = epoll_create1(0)) < 0) {
+    close(lfd);
+    return -1;
+  }
+  server_ep = ep;
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  epoll_ctl(ep, EPOLL_CTL_ADD, lfd, &ev);
+  printf("Serving games on %s\n", address);
+  fflush(stdout);
+
+  while (true) {
+    int n = epoll_wait(ep, events, SERVER_EVENTS, -1);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    for (int i = 0; i < n; i++) {
+      Session *s = events[i].data.ptr;
+      if (s != NULL) {
+        if (session_event(ep, s, events[i].events) != 0)
+          session_close(s);
+        continue;
+      }
+      // new connections
+      int fd;
+      while ((fd = accept(lfd, NULL, NULL)) >= 0) {
+        if (net_nonblock(fd) != 0 || (s = session_open(fd)) == NULL) {
+          close(fd);
+          continue;
+        }
+        ev.events = EPOLLIN;
+        ev.data.ptr = s;
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) != 0)
+          session_close(s);
+      }
+    }
+  }
+  close(ep);
+  close(lfd);
+  return -1;
+}
@@ -0,0 +1,63 @@
+#include "pool.h"
+#include "broadcast.h"
+
+#ifndef BATTLESHIPS_SERVER_H
+#define BATTLESHIPS_SERVER_H
+
+#define SERVER_BACKLOG 1024
+#define SERVER_EVENTS 256
+#define SERVER_LINE 64
+#define SERVER_OUTBUF 512
+
+/*
+ * Session states.
+ */
+#define SESSION_IDLE 0
+#define SESSION_TURN 1
+#define SESSION_OVER 2
+
+/*
+ * One connected client playing against the CPU.
+ * Commands are single lines, every command gets exactly one reply line:
+ *
+ *   NEW <mode>   -> OK <range> <hit_total> [CPU <row> <col> <MISS|HIT|SUNK>]
+ *   FIRE <r> <c> -> <MISS|HIT|SUNK <row> <col> <length> <h|v>|WIN> [CPU <row> <col> <MISS|HIT|SUNK|LOSE>]
+ *   STATS        -> STATS <allocated> <started> <in use> <peak>
+ *   ID           -> ID <id>
+ *   WATCH <id>   -> WATCH <id>, then the game of session <id> as seen by a spectator
+ *   QUIT         -> BYE
+ *
+ * A spectator only gets the stream described in broadcast.h from then on and stays
+ * until the watched session disconnects or it sends QUIT. Only idle sessions can watch.
+ * SUNK names the anchor of the sunk ship. The water around it counts as already
+ * targeted, firing there is answered with ERR target.
+ * Errors are answered with ERR <reason>. Coordinates are 1 based like in the terminal game.
+ * Games run on contexts recycled from one pool per mode, STATS sums their counters.
+ */
+typedef struct session {
+  int fd;
+  int id;
+  int state;
+  bool discard;
+  /* waiting for the socket to take more output */
+  bool polling_out;
+  /* spectators of this session, and the game this session watches */
+  Channel channel;
+  Subscriber watch;
+  bool watching;
+  /* game of the session from the pool of its mode, NULL while idle */
+  Engine *engine;
+  int mode;
+  char in[SERVER_LINE];
+  int in_len;
+  char out[SERVER_OUTBUF];
+  int out_len;
+  int out_off;
+} Session;
+
+int net_listen(const char *address);
+int net_connect(const char *address);
+int net_nonblock(int fd);
+int server_run(const char *address);
+
+#endif //BATTLESHIPS_SERVER_H
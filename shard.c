@@ -0,0 +1,443 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shard.h"
+#include "server.h"
+#include "config.h"
+
+/*
+ * Shard states.
+ */
+#define SHARD_PENDING 0
+#define SHARD_RUNNING 1
+#define SHARD_DONE 2
+
+/*
+ * Connection of one worker to the coordinator.
+ */
+typedef struct worker {
+  int fd;
+  /* shard the worker is playing, -1 if none */
+  int shard;
+  char in[SHARD_LINE];
+  int in_len;
+  /* histograms of the running shard received so far */
+  SimResult part;
+} Worker;
+
+/*
+ * State of a sharded run.
+ */
+typedef struct coordinator {
+  const char *address;
+  const Config *config;
+  uint32_t hash;
+  int games;
+  unsigned int seed;
+  int shard_games;
+  int *state;
+  int done;
+  int lfd;
+  int ep;
+  Worker **workers;
+  int worker_count;
+  int worker_cap;
+  int children;
+  SimResult *result;
+  ShardStats *stats;
+} Coordinator;
+
+/**
+ * @brief Send one formatted line.
+ *
+ * @param fd Target Socket
+ * @param fmt Format String
+ * @return int 0 on success, -1 on error
+ */
+static int shard_send(int fd, const char *fmt, ...) {
+  char line[SHARD_LINE];
+  va_list args;
+
+  va_start(args, fmt);
+  int n = vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+  if (n < 0 || n >= (int)sizeof(line))
+    return -1;
+  return write(fd, line, n) == n ? 0 : -1;
+}
+
+/**
+ * @brief Start a local worker process.
+ *
+ * The child drops the sockets of the coordinator and connects back to it.
+ *
+ * @param co Source Coordinator
+ * @return int 0 on success, -1 if the process couldn't be started
+ */
+static int shard_spawn(Coordinator *co) {
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if (pid < 0)
+    return -1;
+  if (pid == 0) {
+    close(co->lfd);
+    close(co->ep);
+    for (int i = 0; i < co->worker_count; i++) {
+      close(co->workers[i]->fd);
+    }
+    _exit(shard_work(co->address, co->config) == 0 ? 0 : 1);
+  }
+  co->children++;
+  co->stats->workers++;
+  return 0;
+}
+
+/**
+ * @brief Hand the next pending shard to a worker.
+ *
+ * Workers without anything left to do stay connected and idle until the run is over,
+ * so they can take over the shards of workers that disconnect. EXIT is only sent
+ * once every shard is done.
+ *
+ * @param co Source Coordinator
+ * @param w Target Worker
+ * @return int 0 on success, -1 if the worker is gone
+ */
+static int shard_assign(Coordinator *co, Worker *w) {
+  for (int id = 0; id < co->stats->shards; id++) {
+    if (co->state[id] != SHARD_PENDING)
+      continue;
+    int first = id * co->shard_games;
+    int count = co->games - first < co->shard_games ? co->games - first : co->shard_games;
+    co->state[id] = SHARD_RUNNING;
+    w->shard = id;
+    return shard_send(w->fd, "SHARD %d %u %d\n", id, co->seed + (unsigned int)first, count);
+  }
+  w->shard = -1;
+  return 0;
+}
+
+/**
+ * @brief Execute one message of a worker.
+ *
+ * @param co Target Coordinator
+ * @param w Source Worker
+ * @param line Message Line
+ * @return int 0 to keep the worker, -1 to drop it
+ */
+static int shard_message(Coordinator *co, Worker *w, const char *line) {
+  SimResult *part = &w->part;
+  unsigned int hash;
+  int id, m, index;
+  long min, max, count;
+  double sum;
+
+  if (sscanf(line, "HELLO %u", &hash) == 1) {
+    if (hash != co->hash) {
+      shard_send(w->fd, "ERR config\n");
+      return -1;
+    }
+    return shard_assign(co, w);
+  }
+  if (sscanf(line, "HIST %d %ld %ld %lf", &m, &min, &max, &sum) == 4) {
+    if (w->shard < 0 || m < 0 || m >= SIM_HISTOGRAMS)
+      return -1;
+    part->hist[m].min = min;
+    part->hist[m].max = max;
+    part->hist[m].sum = sum;
+    return 0;
+  }
+  if (sscanf(line, "BUCKET %d %d %ld", &m, &index, &count) == 3) {
+    if (w->shard < 0 || m < 0 || m >= SIM_HISTOGRAMS || index < 0 || index >= HIST_BUCKETS)
+      return -1;
+    part->hist[m].buckets[index] += count;
+    part->hist[m].count += count;
+    return 0;
+  }
+  if (sscanf(line, "DONE %d %ld %ld %ld %ld", &id, &part->games, &part->shots, &part->won[0], &part->won[1]) == 5) {
+    if (id != w->shard || co->state[id] != SHARD_RUNNING)
+      return -1;
+    sim_merge(co->result, part);
+    memset(part, 0, sizeof(*part));
+    co->state[id] = SHARD_DONE;
+    co->done++;
+    return shard_assign(co, w);
+  }
+  return -1;
+}
+
+/**
+ * @brief Drop a worker, its running shard goes back to the queue.
+ *
+ * @param co Target Coordinator
+ * @param index Worker Index
+ */
+static void shard_drop(Coordinator *co, int index) {
+  Worker *w = co->workers[index];
+
+  if (w->shard >= 0 && co->state[w->shard] == SHARD_RUNNING) {
+    co->state[w->shard] = SHARD_PENDING;
+    co->stats->reassigned++;
+    // hand it to an idle worker right away
+    for (int i = 0; i < co->worker_count; i++) {
+      if (co->workers[i] != w && co->workers[i]->shard < 0) {
+        shard_assign(co, co->workers[i]);
+        break;
+      }
+    }
+  }
+  epoll_ctl(co->ep, EPOLL_CTL_DEL, w->fd, NULL);
+  close(w->fd);
+  free(w);
+  co->workers[index] = co->workers[--co->worker_count];
+}
+
+/**
+ * @brief Read from a worker and execute its complete messages.
+ *
+ * @param co Target Coordinator
+ * @param w Source Worker
+ * @return int 0 to keep the worker, -1 to drop it
+ */
+static int shard_read(Coordinator *co, Worker *w) {
+  ssize_t n = read(w->fd, w->in + w->in_len, SHARD_LINE - w->in_len);
+  char *start = w->in, *end;
+  int ret = 0;
+
+  if (n <= 0)
+    return (n < 0 && (errno == EAGAIN || errno == EINTR)) ? 0 : -1;
+  w->in_len += n;
+  while (ret == 0 && (end = memchr(start, '\n', w->in + w->in_len - start)) != NULL) {
+    *end = '\0';
+    ret = shard_message(co, w, start);
+    start = end + 1;
+  }
+  w->in_len -= start - w->in;
+  memmove(w->in, start, w->in_len);
+  return ret == 0 && w->in_len < SHARD_LINE ? 0 : -1;
+}
+
+/**
+ * @brief Accept connecting workers.
+ *
+ * @param co Target Coordinator
+ */
+static void shard_accept(Coordinator *co) {
+  struct epoll_event ev;
+  int fd;
+
+  while ((fd = accept(co->lfd, NULL, NULL)) >= 0) {
+    Worker *w = calloc(1, sizeof(Worker));
+    if (co->worker_count == co->worker_cap) {
+      int cap = co->worker_cap ? 2 * co->worker_cap : 16;
+      Worker **tmp = realloc(co->workers, cap * sizeof(Worker *));
+      if (tmp != NULL) {
+        co->workers = tmp;
+        co->worker_cap = cap;
+      }
+    }
+    if (w == NULL || co->worker_count == co->worker_cap || net_nonblock(fd) != 0) {
+      free(w);
+      close(fd);
+      continue;
+    }
+    w->fd = fd;
+    w->shard = -1;
+    ev.events = EPOLLIN;
+    ev.data.ptr = w;
+    epoll_ctl(co->ep, EPOLL_CTL_ADD, fd, &ev);
+    co->workers[co->worker_count++] = w;
+  }
+}
+
+/**
+ * @brief Run a simulation split into shards over worker processes.
+ *
+ * Starts @c workers local worker processes which connect to @c address. Workers on
+ * other machines can join with @c shard_work(). If every worker is gone while
+ * shards are left, up to @c SHARD_RESPAWNS local replacements are started.
+ *
+ * @param address Listen Address, see @c net_listen()
+ * @param config Board Size and Fleet
+ * @param games Number of Games
+ * @param seed Random Seed of the first game
+ * @param shard_games Games per Shard
+ * @param workers Local Worker Processes
+ * @param result Totals of all games, equal to @c sim_run() with the same seeds
+ * @param stats Shards, reassigned shards, started workers and wall clock time
+ * @return int 0 on success, -1 on errors
+ */
+int shard_coordinate(const char *address, const Config *config, int games, unsigned int seed, int shard_games,
+                     int workers, SimResult *result, ShardStats *stats) {
+  struct epoll_event ev, events[SERVER_EVENTS];
+  struct timespec begin, end;
+  Coordinator co = {0};
+  int respawns = 0, ret = 0;
+
+  memset(result, 0, sizeof(*result));
+  memset(stats, 0, sizeof(*stats));
+  if (games <= 0 || shard_games <= 0 || workers < 0)
+    return -1;
+  co.address = address;
+  co.config = config;
+  co.hash = config_hash(config);
+  co.games = games;
+  co.seed = seed;
+  co.shard_games = shard_games;
+  co.result = result;
+  co.stats = stats;
+  stats->shards = (games + shard_games - 1) / shard_games;
+  if ((co.state = calloc(stats->shards, sizeof(int))) == NULL)
+    return -1;
+  if ((co.lfd = net_listen(address)) < 0) {
+    fprintf(stderr, "Could not listen on %s\n", address);
+    free(co.state);
+    return -1;
+  }
+  if ((co.ep = epoll_create1(0)) < 0) {
+    close(co.lfd);
+    free(co.state);
+    return -1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  epoll_ctl(co.ep, EPOLL_CTL_ADD, co.lfd, &ev);
+  for (int i = 0; i < workers; i++) {
+    if (shard_spawn(&co) != 0)
+      break;
+  }
+
+  while (co.done < stats->shards) {
+    int n = epoll_wait(co.ep, events, SERVER_EVENTS, 100);
+    if (n < 0 && errno != EINTR) {
+      ret = -1;
+      break;
+    }
+    for (int i = 0; i < n; i++) {
+      Worker *w = events[i].data.ptr;
+      if (w == NULL) {
+        shard_accept(&co);
+      } else if (shard_read(&co, w) != 0) {
+        for (int k = 0; k < co.worker_count; k++) {
+          if (co.workers[k] == w) {
+            shard_drop(&co, k);
+            break;
+          }
+        }
+      }
+    }
+    // reap dead local workers, replace them once nobody is left
+    while (co.children > 0 && waitpid(-1, NULL, WNOHANG) > 0) {
+      co.children--;
+    }
+    if (workers > 0 && co.children == 0 && co.worker_count == 0 && co.done < stats->shards) {
+      if (respawns++ == SHARD_RESPAWNS || shard_spawn(&co) != 0) {
+        fprintf(stderr, "All workers failed\n");
+        ret = -1;
+        break;
+      }
+    }
+  }
+
+  for (int i = 0; i < co.worker_count; i++) {
+    shard_send(co.workers[i]->fd, "EXIT\n");
+    close(co.workers[i]->fd);
+    free(co.workers[i]);
+  }
+  while (co.children > 0 && waitpid(-1, NULL, 0) > 0) {
+    co.children--;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  stats->elapsed = (double)(end.tv_sec - begin.tv_sec) + (double)(end.tv_nsec - begin.tv_nsec) / 1e9;
+  free(co.workers);
+  free(co.state);
+  close(co.ep);
+  close(co.lfd);
+  return ret;
+}
+
+/**
+ * @brief Send the result of a shard to the coordinator.
+ *
+ * The histograms go first, only their non-empty buckets are sent.
+ *
+ * @param fd Coordinator Socket
+ * @param id Shard ID
+ * @param part Shard Result
+ * @return int 0 on success, -1 on error
+ */
+static int shard_report(int fd, int id, const SimResult *part) {
+  for (int m = 0; m < SIM_HISTOGRAMS; m++) {
+    const Histogram *hist = &part->hist[m];
+    if (hist->count == 0)
+      continue;
+    if (shard_send(fd, "HIST %d %ld %ld %.0f\n", m, hist->min, hist->max, hist->sum) != 0)
+      return -1;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+      if (hist->buckets[i] != 0 && shard_send(fd, "BUCKET %d %d %ld\n", m, i, hist->buckets[i]) != 0)
+        return -1;
+    }
+  }
+  return shard_send(fd, "DONE %d %ld %ld %ld %ld\n", id, part->games, part->shots, part->won[0], part->won[1]);
+}
+
+/**
+ * @brief Play shards for a coordinator until it sends the worker home.
+ *
+ * @param address Coordinator Address, see @c net_connect()
+ * @param config Board Size and Fleet, has to match the coordinator
+ * @return int 0 on success, -1 on errors
+ */
+int shard_work(const char *address, const Config *config) {
+  char in[SHARD_LINE];
+  int in_len = 0, fd, ret = 1;
+
+  if ((fd = net_connect(address)) < 0) {
+    fprintf(stderr, "Could not connect to %s\n", address);
+    return -1;
+  }
+  if (shard_send(fd, "HELLO %u\n", (unsigned int)config_hash(config)) != 0) {
+    close(fd);
+    return -1;
+  }
+  while (ret > 0) {
+    ssize_t n = read(fd, in + in_len, sizeof(in) - in_len);
+    char *start = in, *end;
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    in_len += n;
+    while (ret > 0 && (end = memchr(start, '\n', in + in_len - start)) != NULL) {
+      SimResult part;
+      unsigned int first;
+      int id, count;
+      *end = '\0';
+      if (sscanf(start, "SHARD %d %u %d", &id, &first, &count) == 3) {
+        if (sim_run(count, config, first, &part) != 0 || shard_report(fd, id, &part) != 0)
+          ret = -1;
+      } else if (strcmp(start, "EXIT") == 0) {
+        ret = 0;
+      } else {
+        fprintf(stderr, "Coordinator refused: %s\n", start);
+        ret = -1;
+      }
+      start = end + 1;
+    }
+    in_len -= start - in;
+    memmove(in, start, in_len);
+  }
+  close(fd);
+  return ret == 0 ? 0 : -1;
+}
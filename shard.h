@@ -0,0 +1,37 @@
+#include "simulate.h"
+
+#ifndef BATTLESHIPS_SHARD_H
+#define BATTLESHIPS_SHARD_H
+
+#define SHARD_LINE 128
+/* replacement workers started when all workers of a run died */
+#define SHARD_RESPAWNS 8
+
+/*
+ * Simulation spread over worker processes. The coordinator splits the seeds of a run
+ * into shards and hands them out over a socket, one line per message:
+ *
+ *   worker:      HELLO <config hash>
+ *   coordinator: SHARD <id> <first seed> <games> | EXIT | ERR config
+ *   worker:      HIST <histogram> <min> <max> <sum>, BUCKET <histogram> <bucket> <count> ...
+ *                DONE <id> <games> <shots> <won 1> <won 2>
+ *
+ * Workers report every shard as soon as it is played, the histograms (see simulate.h)
+ * with their non-empty buckets first. Shards of workers that
+ * disconnect are handed to the next free worker, so idle workers are only sent EXIT
+ * once every shard is done. Game g of a run is always played
+ * with seed + g, so the totals match a single process run of the same seeds.
+ */
+typedef struct shard_stats {
+  int shards;
+  int reassigned;
+  int workers;
+  /* wall clock time of the run in seconds */
+  double elapsed;
+} ShardStats;
+
+int shard_coordinate(const char *address, const Config *config, int games, unsigned int seed, int shard_games,
+                     int workers, SimResult *result, ShardStats *stats);
+int shard_work(const char *address, const Config *config);
+
+#endif //BATTLESHIPS_SHARD_H
@@ -0,0 +1,153 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+
+#include "simulate.h"
+
+const char *const sim_histogram_names[SIM_HISTOGRAMS] = {"shots_to_win", "rounds", "placement_ns", "decision_ns",
+                                                         "turn_ns"};
+
+/**
+ * @brief Nanoseconds between two points in time.
+ *
+ * @param from Start
+ * @param to End
+ * @return long
+ */
+static long elapsed_ns(struct timespec from, struct timespec to) {
+  return (to.tv_sec - from.tv_sec) * 1000000000L + (to.tv_nsec - from.tv_nsec);
+}
+
+/**
+ * @brief Play a batch of CPU against CPU games without any output.
+ *
+ * Drives one engine after the other to the end on a single recycled context, so
+ * no game allocates. Game @c g is played with the random seed @c seed + g, so a
+ * range of seeds gives the same totals no matter how it is split into batches.
+ * Game lengths and the time spent placing fleets are recorded into the histograms of
+ * @c result for every game, decision and turn times for every @c SIM_SAMPLE th turn.
+ *
+ * @param games Number of Games
+ * @param config Board Size and Fleet
+ * @param seed Random Seed of the first game
+ * @param result Totals of all games
+ * @return int 0 on success, -1 if a game couldn't be set up or ran out of memory
+ */
+int sim_run(int games, const Config *config, unsigned int seed, SimResult *result) {
+  Pool pool;
+  Engine *engine;
+  long turns = 0;
+  int ret = 0;
+
+  memset(result, 0, sizeof(*result));
+  if (pool_init(&pool, config, 1) != 0)
+    return -1;
+  for (int g = 0; g < games; g++) {
+    struct timespec begin, aimed, end;
+    srand(seed + (unsigned int)g);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    if ((engine = pool_acquire(&pool, 0)) == NULL) {
+      ret = -1;
+      break;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    hist_record(&result->hist[SIM_PLACEMENT], elapsed_ns(begin, end));
+    while (engine->state == ENGINE_CPU) {
+      if (++turns % SIM_SAMPLE != 0) {
+        engine_step(engine);
+        continue;
+      }
+      clock_gettime(CLOCK_MONOTONIC, &begin);
+      engine_aim(engine);
+      clock_gettime(CLOCK_MONOTONIC, &aimed);
+      engine_step(engine);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      hist_record(&result->hist[SIM_DECISION], elapsed_ns(begin, aimed));
+      hist_record(&result->hist[SIM_TURN], elapsed_ns(begin, end));
+    }
+    const Game *game = &engine->game;
+    // a game only ends without a winner when memory ran out
+    if (!game_won(game)) {
+      pool_release(&pool, engine);
+      ret = -1;
+      break;
+    }
+    result->games++;
+    result->shots += game->pstats_[0].shots + game->pstats_[1].shots;
+    result->won[game->player_current]++;
+    hist_record(&result->hist[SIM_SHOTS_TO_WIN], game->pstats_[game->player_current].shots);
+    // sub_round starts at 1, one ahead of the rounds played
+    hist_record(&result->hist[SIM_ROUNDS], game->sub_round - 1);
+    pool_release(&pool, engine);
+  }
+  result->pool = pool.stats;
+  pool_free(&pool);
+  return ret;
+}
+
+/**
+ * @brief Add the totals of one batch to another.
+ *
+ * @param total Target Totals
+ * @param part Batch Totals
+ */
+void sim_merge(SimResult *total, const SimResult *part) {
+  total->games += part->games;
+  total->shots += part->shots;
+  total->won[0] += part->won[0];
+  total->won[1] += part->won[1];
+  for (int i = 0; i < SIM_HISTOGRAMS; i++) {
+    hist_merge(&total->hist[i], &part->hist[i]);
+  }
+}
+
+/**
+ * @brief Prompts the totals of a batch run.
+ *
+ * @param result Totals
+ * @param secs Elapsed Seconds
+ */
+void sim_print(const SimResult *result, double secs) {
+  printf("games: %ld, shots: %ld (%.2f per game), won: %ld / %ld\n", result->games, result->shots,
+         result->games ? (double)result->shots / result->games : 0.0, result->won[0], result->won[1]);
+  printf("elapsed: %.3f s, %.1f games/s\n", secs, secs > 0 ? result->games / secs : 0.0);
+  for (int i = 0; i < SIM_HISTOGRAMS; i++) {
+    const Histogram *hist = &result->hist[i];
+    printf("%s: mean %.1f, p50 %ld, p90 %ld, p99 %ld, max %ld\n", sim_histogram_names[i], hist_mean(hist),
+           hist_percentile(hist, 50.0), hist_percentile(hist, 90.0), hist_percentile(hist, 99.0), hist->max);
+  }
+}
+
+/**
+ * @brief Write the histograms of a batch run to a file.
+ *
+ * Files ending in @c .json get every histogram with its buckets, all others a CSV
+ * table with one summary row per histogram.
+ *
+ * @param result Source Totals
+ * @param path Target File
+ * @return int 0 on success, -1 on IO errors
+ */
+int sim_export(const SimResult *result, const char *path) {
+  size_t len = strlen(path);
+  bool json = len >= 5 && strcmp(path + len - 5, ".json") == 0;
+  FILE *fw = fopen(path, "w");
+
+  if (fw == NULL)
+    return -1;
+  if (json) {
+    fprintf(fw, "{\"games\": %ld, \"shots\": %ld, \"won\": [%ld, %ld]", result->games, result->shots,
+            result->won[0], result->won[1]);
+    for (int i = 0; i < SIM_HISTOGRAMS; i++) {
+      fprintf(fw, ", ");
+      hist_json(fw, sim_histogram_names[i], &result->hist[i]);
+    }
+    fprintf(fw, "}\n");
+  } else {
+    fprintf(fw, "metric,count,min,mean,p50,p90,p99,p99.9,max\n");
+    for (int i = 0; i < SIM_HISTOGRAMS; i++) {
+      hist_csv(fw, sim_histogram_names[i], &result->hist[i]);
+    }
+  }
+  return fclose(fw) == 0 ? 0 : -1;
+}
@@ -0,0 +1,37 @@
+#include "pool.h"
+#include "hist.h"
+
+#ifndef BATTLESHIPS_SIMULATE_H
+#define BATTLESHIPS_SIMULATE_H
+
+/*
+ * Histograms of a batch run, times are in nanoseconds.
+ */
+#define SIM_SHOTS_TO_WIN 0 /* shots of the winner */
+#define SIM_ROUNDS 1       /* rounds per game */
+#define SIM_PLACEMENT 2    /* placing both fleets */
+#define SIM_DECISION 3     /* CPU picking its targets */
+#define SIM_TURN 4         /* whole turn including the decision */
+#define SIM_HISTOGRAMS 5
+/* one in this many turns is timed, reading the clock costs about a tenth of a turn */
+#define SIM_SAMPLE 16
+
+extern const char *const sim_histogram_names[SIM_HISTOGRAMS];
+
+/*
+ * Totals of a batch of CPU against CPU games.
+ */
+typedef struct sim_result {
+  long games;
+  long shots;
+  long won[2];
+  PoolStats pool;
+  Histogram hist[SIM_HISTOGRAMS];
+} SimResult;
+
+int sim_run(int games, const Config *config, unsigned int seed, SimResult *result);
+void sim_merge(SimResult *total, const SimResult *part);
+void sim_print(const SimResult *result, double secs);
+int sim_export(const SimResult *result, const char *path);
+
+#endif //BATTLESHIPS_SIMULATE_H
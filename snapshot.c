@@ -0,0 +1,332 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+#include "kernel.h"
+
+/**
+ * @brief Size of the ship tables and the cells of both boards in the file.
+ *
+ * @param game_range Target Board Dimension
+ * @param ship_total Ship Counter
+ * @return size_t
+ */
+static size_t tables_size(int game_range, int ship_total) {
+  return (size_t)ship_total * (sizeof(int32_t) + 2 * sizeof(Ship)) + 2 * (size_t)game_range * (size_t)game_range * sizeof(Cell);
+}
+
+/**
+ * @brief Checks that a snapshot holds a game that can be played to the end.
+ *
+ * The checksum only catches accidental damage, a file with a matching checksum can
+ * still hold a player, ship, cell or symbol that points outside the game, or hits
+ * that don't add up so the game can never be won.
+ *
+ * @param body Snapshot Body followed by the tables, sizes already checked
+ * @return true
+ * @return false
+ */
+static bool snapshot_valid(const SnapshotBody *body) {
+  int n = body->game_range, total = body->ship_total;
+  const int32_t *modes = (const int32_t *)(body + 1);
+  const Ship *ships = (const Ship *)(modes + total);
+  const Cell *cells = (const Cell *)(ships + 2 * (size_t)total);
+  long hit_total = 0;
+
+  if (body->player_current < 0 || body->player_current > 1 || body->player_total < 0 || body->player_total > 2)
+    return false;
+  for (int j = 0; j < total; j++) {
+    if (modes[j] <= 0 || modes[j] > n)
+      return false;
+    hit_total += modes[j];
+  }
+  if (body->hit_total != hit_total)
+    return false;
+  for (int p = 0; p < 2; p++) {
+    const Cell *board = cells + (size_t)p * n * n;
+    long hits = 0, segments = 0;
+    for (size_t i = 0; i < (size_t)n * n; i++) {
+      int id = board[i].shipid, symbol = board[i].symbol;
+      // water is missed or not, a segment is hit or shows its ship
+      if (id == -1 ? symbol != WATER && symbol != MISS
+                   : id < -1 || id >= total ||
+                         (symbol != HIT && symbol != watercraft(ship_type_default, modes[id])->id))
+        return false;
+      segments += id > -1;
+    }
+    for (int j = 0; j < total; j++) {
+      const Ship *ship = &ships[(size_t)p * total + j];
+      int mode = modes[j], dir = ship->direction, found = 0;
+      if (ship->size != mode || (dir != 0 && dir != 1) || ship->position.row < 0 || ship->position.col < 0 ||
+          ship->position.row + (dir == 1 ? mode : 1) > n || ship->position.col + (dir == 0 ? mode : 1) > n)
+        return false;
+      // the ship covers exactly its segments and its hits are the hit ones
+      for (int k = 0; k < mode; k++) {
+        const Cell *cell = &board[(size_t)(ship->position.row + dir * k) * n + ship->position.col + (1 - dir) * k];
+        if (cell->shipid != j)
+          return false;
+        found += cell->symbol == HIT;
+      }
+      if (ship->hits != found || ship->sunk != (found == mode))
+        return false;
+      hits += found;
+    }
+    // the opponent of the board's owner scored its hits
+    if (segments != hit_total || body->hit_count[!p] != hits)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Copy one row of a board into a buffer.
+ *
+ * Dense boards hand out their row directly, sparse boards are expanded into @c buf.
+ *
+ * @param board Source Board
+ * @param row Row
+ * @param buf Row Buffer, game_range cells
+ * @return const Cell* the row
+ */
+static const Cell *board_row(const Board *board, int row, Cell *buf) {
+  if (board->cells != NULL)
+    return board->cells[row];
+  for (int j = 0; j < board->game_range; j++) {
+    buf[j] = board_cell(board, row, j);
+  }
+  return buf;
+}
+
+/**
+ * @brief Write the whole game into a snapshot file.
+ *
+ * The file is written next to @c path first and renamed afterwards, so a crash while
+ * saving never leaves a broken snapshot behind. Sparse boards are written out in full
+ * and resume as dense boards.
+ *
+ * @param game Source Game
+ * @param path Snapshot File
+ * @return int 0 on success, -1 on IO errors
+ */
+int snapshot_save(const Game *game, const char *path) {
+  SnapshotHeader header = {0};
+  SnapshotBody body = {0};
+  char tmp_path[256];
+  FILE *fw = NULL;
+  Cell *row = malloc(game->game_range * sizeof(Cell));
+
+  if (row == NULL) {
+    return -1;
+  }
+
+  body.game_range = game->game_range;
+  body.ship_total = game->ship_total;
+  body.hit_total = game->hit_total;
+  body.player_total = game->player_total;
+  body.player_current = game->player_current;
+  body.game_round = game->game_round;
+  body.sub_round = game->sub_round;
+  body.salvo = game->salvo;
+  for (int p = 0; p < 2; p++) {
+    body.hit_count[p] = game->hit_count[p];
+    body.stats[p][0] = game->pstats_[p].hit;
+    body.stats[p][1] = game->pstats_[p].shots;
+    body.stats[p][2] = game->pstats_[p].miss;
+    body.stats[p][3] = game->pstats_[p].total;
+    body.stats[p][4] = game->pstats_[p].won;
+    body.stats[p][5] = game->pstats_[p].lost;
+  }
+
+  header.magic = SNAPSHOT_MAGIC;
+  header.version = SNAPSHOT_VERSION;
+  size_t modes = game->ship_total * sizeof(int32_t);
+  size_t ships = game->ship_total * sizeof(Ship);
+  header.size = (uint32_t)(sizeof(header) + sizeof(body) + tables_size(game->game_range, game->ship_total));
+  header.checksum = fnv1a(FNV_BASIS, &body, sizeof(body));
+  header.checksum = fnv1a(header.checksum, game->ship_mode, modes);
+  header.checksum = fnv1a(header.checksum, game->player[0].ships, ships);
+  header.checksum = fnv1a(header.checksum, game->player[1].ships, ships);
+  for (int p = 0; p < 2; p++) {
+    for (int i = 0; i < game->game_range; i++) {
+      header.checksum = fnv1a(header.checksum, board_row(&game->player[p], i, row), game->game_range * sizeof(Cell));
+    }
+  }
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  if ((fw = fopen(tmp_path, "wb")) == NULL) {
+    free(row);
+    return -1;
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, fw) == 1 && fwrite(&body, sizeof(body), 1, fw) == 1 &&
+            fwrite(game->ship_mode, 1, modes, fw) == modes && fwrite(game->player[0].ships, 1, ships, fw) == ships &&
+            fwrite(game->player[1].ships, 1, ships, fw) == ships;
+  for (int p = 0; ok && p < 2; p++) {
+    for (int i = 0; ok && i < game->game_range; i++) {
+      ok = fwrite(board_row(&game->player[p], i, row), sizeof(Cell), game->game_range, fw) == (size_t)game->game_range;
+    }
+  }
+  free(row);
+  if (fclose(fw) != 0 || !ok) {
+    remove(tmp_path);
+    return -1;
+  }
+  return rename(tmp_path, path) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Open and verify a snapshot file.
+ *
+ * Maps the file read only and checks magic, version, size, checksum and the game
+ * itself once, see @c snapshot_valid(), so forking games from it later is just a mapping.
+ *
+ * @param snap Target Snapshot
+ * @param path Snapshot File
+ * @return int 0 on success, -1 if the file is missing or damaged
+ */
+int snapshot_open(Snapshot *snap, const char *path) {
+  struct stat st;
+
+  snap->header = NULL;
+  if ((snap->fd = open(path, O_RDONLY)) < 0) {
+    return -1;
+  }
+  if (fstat(snap->fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader) + sizeof(SnapshotBody)) {
+    snapshot_close(snap);
+    return -1;
+  }
+  snap->size = (size_t)st.st_size;
+  void *base = mmap(NULL, snap->size, PROT_READ, MAP_SHARED, snap->fd, 0);
+  if (base == MAP_FAILED) {
+    snapshot_close(snap);
+    return -1;
+  }
+  snap->header = base;
+
+  const SnapshotBody *body = (const SnapshotBody *)(snap->header + 1);
+  if (snap->header->magic != SNAPSHOT_MAGIC || snap->header->version != SNAPSHOT_VERSION ||
+      snap->header->size != snap->size || body->game_range <= 0 || body->game_range > MAX_RANGE ||
+      body->ship_total <= 0 || body->ship_total > MAX_FLEET ||
+      sizeof(SnapshotHeader) + sizeof(SnapshotBody) + tables_size(body->game_range, body->ship_total) != snap->size ||
+      fnv1a(FNV_BASIS, body, snap->size - sizeof(SnapshotHeader)) != snap->header->checksum ||
+      !snapshot_valid(body)) {
+    snapshot_close(snap);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Start a new game continuation from an opened snapshot.
+ *
+ * Each fork gets a private copy-on-write mapping of the file: the boards are used in
+ * place without copying and only the cells a continuation actually shoots at are
+ * duplicated. Any number of games can be forked from the same snapshot.
+ *
+ * @param snap Source Snapshot
+ * @param game Target Game, release with @c game_free()
+ * @return int 0 on success, -1 when out of memory
+ */
+int snapshot_fork(const Snapshot *snap, Game *game) {
+  void *base = mmap(NULL, snap->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, snap->fd, 0);
+  if (base == MAP_FAILED) {
+    return -1;
+  }
+  const SnapshotBody *body = (const SnapshotBody *)((const SnapshotHeader *)base + 1);
+  int32_t *modes = (int32_t *)(body + 1);
+  Ship *ships = (Ship *)(modes + body->ship_total);
+  Cell *cells = (Cell *)(ships + 2 * (size_t)body->ship_total);
+
+  memset(game, 0, sizeof(*game));
+  game->mapping = base;
+  game->mapping_size = snap->size;
+  game->game_range = body->game_range;
+  game->ship_total = body->ship_total;
+  game->hit_total = body->hit_total;
+  game->player_total = body->player_total;
+  game->player_current = body->player_current;
+  game->game_round = body->game_round;
+  game->sub_round = body->sub_round;
+  game->salvo = body->salvo;
+  for (int p = 0; p < 2; p++) {
+    game->hit_count[p] = body->hit_count[p];
+    game->pstats_[p].hit = body->stats[p][0];
+    game->pstats_[p].shots = body->stats[p][1];
+    game->pstats_[p].miss = body->stats[p][2];
+    game->pstats_[p].total = body->stats[p][3];
+    game->pstats_[p].won = body->stats[p][4];
+    game->pstats_[p].lost = body->stats[p][5];
+    game->pstats_[p].ratio = (game->pstats_[p].hit == 0 ? 0.0 : (double)game->pstats_[p].hit / (double)game->pstats_[p].shots);
+  }
+  // ship tables and rows point straight into the mapping
+  game->ship_mode = modes;
+
+  memset(game->player, 0, sizeof(game->player));
+  for (int p = 0; p < 2; p++) {
+    game->player[p].game_range = game->game_range;
+    game->player[p].ships = ships + (size_t)p * body->ship_total;
+    game->player[p].kernel = kernel_select(game->game_range, false);
+    game->player[p].cells = malloc(game->game_range * sizeof(Cell *));
+    if (game->player[p].cells == NULL) {
+      game_free(game);
+      return -1;
+    }
+    for (int i = 0; i < game->game_range; i++) {
+      game->player[p].cells[i] = cells + ((size_t)p * game->game_range + i) * game->game_range;
+    }
+    board_occupancy(&game->player[p]);
+    game->ships_left[p] = 0;
+    for (int j = 0; j < body->ship_total; j++) {
+      game->ships_left[p] += !game->player[p].ships[j].sunk;
+    }
+    game->fields_left[p] = 0;
+    for (size_t i = 0; i < (size_t)game->game_range * game->game_range; i++) {
+      Cell cell = cells[(size_t)p * game->game_range * game->game_range + i];
+      game->fields_left[p] += cell.symbol != HIT && cell.symbol != MISS;
+    }
+  }
+  if (game->salvo && sparse_init(&game->salvo_set, 0) != 0) {
+    game_free(game);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Close a snapshot file.
+ *
+ * Games forked from the snapshot stay valid.
+ *
+ * @param snap Target Snapshot
+ */
+void snapshot_close(Snapshot *snap) {
+  if (snap->header != NULL) {
+    munmap((void *)snap->header, snap->size);
+    snap->header = NULL;
+  }
+  if (snap->fd >= 0) {
+    close(snap->fd);
+    snap->fd = -1;
+  }
+}
+
+/**
+ * @brief Resume a single game from a snapshot file.
+ *
+ * @param game Target Game, release with @c game_free()
+ * @param path Snapshot File
+ * @return int 0 on success, -1 if the file is missing or damaged
+ */
+int snapshot_load(Game *game, const char *path) {
+  Snapshot snap;
+
+  if (snapshot_open(&snap, path) != 0) {
+    return -1;
+  }
+  int ret = snapshot_fork(&snap, game);
+  snapshot_close(&snap);
+  return ret;
+}
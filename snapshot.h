@@ -0,0 +1,54 @@
+#include "game.h"
+
+#ifndef BATTLESHIPS_SNAPSHOT_H
+#define BATTLESHIPS_SNAPSHOT_H
+
+#include <stdint.h>
+
+#define SNAPSHOTFILE "game.snap"
+/* "BSNP" read as a native integer; a byte swapped magic means a foreign machine */
+#define SNAPSHOT_MAGIC 0x504e5342u
+#define SNAPSHOT_VERSION 4
+
+/*
+ * Fixed file layout: header, body, the ship lengths and the ship tables of both players
+ * (ship_total entries each), then the cells of player 1 and player 2 row by row.
+ * All fields are native 32 bit integers so ships and cells can be used straight from the mapping.
+ */
+typedef struct snapshot_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  uint32_t checksum;
+} SnapshotHeader;
+
+typedef struct snapshot_body {
+  int32_t game_range;
+  int32_t ship_total;
+  int32_t hit_total;
+  int32_t player_total;
+  int32_t player_current;
+  int32_t game_round;
+  int32_t sub_round;
+  int32_t hit_count[2];
+  int32_t salvo;
+  /* hit, shots, miss, total, won, lost per player; the ratio is recomputed */
+  int32_t stats[2][6];
+} SnapshotBody;
+
+/*
+ * Opened snapshot file, shared by all games forked from it.
+ */
+typedef struct snapshot {
+  int fd;
+  size_t size;
+  const SnapshotHeader *header;
+} Snapshot;
+
+int snapshot_save(const Game *game, const char *path);
+int snapshot_open(Snapshot *snap, const char *path);
+int snapshot_fork(const Snapshot *snap, Game *game);
+void snapshot_close(Snapshot *snap);
+int snapshot_load(Game *game, const char *path);
+
+#endif //BATTLESHIPS_SNAPSHOT_H
@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "sparse.h"
+
+/**
+ * @brief Home slot of a key.
+ *
+ * Fibonacci hashing spreads neighbouring cells over the whole table.
+ *
+ * @param table Target Table
+ * @param key Cell Key
+ * @return uint32_t
+ */
+static uint32_t sparse_slot(const Sparse *table, uint32_t key) {
+  return (uint32_t)((key * 2654435769u) >> 7) & table->mask;
+}
+
+/**
+ * @brief Allocate an empty table.
+ *
+ * @param table Target Table
+ * @param capacity Expected Entries
+ * @return int 0 on success, -1 when out of memory
+ */
+int sparse_init(Sparse *table, uint32_t capacity) {
+  uint32_t slots = SPARSE_MIN_CAPACITY;
+
+  // keep the load below one half
+  while (slots < 2 * capacity)
+    slots *= 2;
+  table->keys = malloc(slots * sizeof(uint32_t));
+  table->values = malloc(slots * sizeof(int32_t));
+  if (table->keys == NULL || table->values == NULL) {
+    sparse_free(table);
+    return -1;
+  }
+  table->mask = slots - 1;
+  sparse_reset(table);
+  return 0;
+}
+
+/**
+ * @brief Release a table.
+ *
+ * @param table Target Table
+ */
+void sparse_free(Sparse *table) {
+  free(table->keys);
+  free(table->values);
+  table->keys = NULL;
+  table->values = NULL;
+  table->mask = 0;
+  table->count = 0;
+}
+
+/**
+ * @brief Remove all entries.
+ *
+ * @param table Target Table
+ */
+void sparse_reset(Sparse *table) {
+  memset(table->keys, 0xff, ((size_t)table->mask + 1) * sizeof(uint32_t));
+  table->count = 0;
+}
+
+/**
+ * @brief Look up a key.
+ *
+ * @param table Source Table
+ * @param key Cell Key
+ * @param value Stored Value
+ * @return true
+ * @return false key not present
+ */
+bool sparse_get(const Sparse *table, uint32_t key, int32_t *value) {
+  for (uint32_t i = sparse_slot(table, key);; i = (i + 1) & table->mask) {
+    if (table->keys[i] == key) {
+      *value = table->values[i];
+      return true;
+    }
+    if (table->keys[i] == SPARSE_EMPTY)
+      return false;
+  }
+}
+
+/**
+ * @brief Double the table size and rehash all entries.
+ *
+ * @param table Target Table, unchanged when out of memory
+ * @return int 0 on success, -1 when out of memory
+ */
+static int sparse_grow(Sparse *table) {
+  Sparse old = *table;
+
+  if (sparse_init(table, (old.mask + 1)) != 0) {
+    *table = old;
+    return -1;
+  }
+  // the new table has room for every entry, these puts never grow
+  for (uint32_t i = 0; i <= old.mask; i++) {
+    if (old.keys[i] != SPARSE_EMPTY)
+      sparse_put(table, old.keys[i], old.values[i]);
+  }
+  sparse_free(&old);
+  return 0;
+}
+
+/**
+ * @brief Insert a key or update its value.
+ *
+ * @param table Target Table
+ * @param key Cell Key
+ * @param value Value
+ * @return int 0 on success, -1 when out of memory
+ */
+int sparse_put(Sparse *table, uint32_t key, int32_t value) {
+  if (2 * (table->count + 1) > table->mask + 1 && sparse_grow(table) != 0)
+    return -1;
+  for (uint32_t i = sparse_slot(table, key);; i = (i + 1) & table->mask) {
+    if (table->keys[i] == SPARSE_EMPTY) {
+      table->keys[i] = key;
+      table->values[i] = value;
+      table->count++;
+      return 0;
+    }
+    if (table->keys[i] == key) {
+      table->values[i] = value;
+      return 0;
+    }
+  }
+}
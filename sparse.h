@@ -0,0 +1,29 @@
+#ifndef BATTLESHIPS_SPARSE_H
+#define BATTLESHIPS_SPARSE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPARSE_EMPTY UINT32_MAX
+#define SPARSE_MIN_CAPACITY 64
+
+/*
+ * Open addressing hash table from cell keys (row * game_range + col) to values.
+ * Linear probing, grows at half load. Entries are never removed one by one,
+ * only the whole table is reset.
+ */
+typedef struct sparse {
+  uint32_t *keys;
+  int32_t *values;
+  uint32_t mask;
+  uint32_t count;
+} Sparse;
+
+int sparse_init(Sparse *table, uint32_t capacity);
+void sparse_free(Sparse *table);
+void sparse_reset(Sparse *table);
+bool sparse_get(const Sparse *table, uint32_t key, int32_t *value);
+int sparse_put(Sparse *table, uint32_t key, int32_t value);
+
+#endif //BATTLESHIPS_SPARSE_H